@@ -0,0 +1,32 @@
+/*
+    Passo de envelhecimento e morte sobre o grid inteiro, em cada layout,
+    comparando a versão escalar com a despachada (AVX2 quando disponível).
+*/
+
+#include "aging.h"
+#include "bench_common.h"
+#include <benchmark/benchmark.h>
+
+static const aging_rules_t bench_rules = {{0, 10, 50, 80}, {false, false, true, true}};
+
+template <typename Grid, bool Vectorized>
+static void BM_aging_pass(benchmark::State &state) {
+    Grid initial;
+    fill_grid(initial, state.range(0), 0.3);
+    Grid grid = initial;
+    for (auto _ : state) {
+        // Restaura o grid original, para que toda passagem veja a mesma população
+        state.PauseTiming();
+        grid = initial;
+        state.ResumeTiming();
+        size_t deaths = Vectorized ? age_entities(grid, bench_rules) : age_entities_scalar(grid, bench_rules);
+        benchmark::DoNotOptimize(deaths);
+    }
+    state.SetItemsProcessed(state.iterations() * grid.size());
+    state.SetBytesProcessed(state.iterations() * grid.size() * grid.cell_bytes());
+}
+BENCHMARK_TEMPLATE(BM_aging_pass, aos_grid_t, false)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_aging_pass, packed_grid_t, false)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_aging_pass, packed_grid_t, true)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_aging_pass, soa_grid_t, false)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_aging_pass, soa_grid_t, true)->Arg(1024)->Arg(4096);
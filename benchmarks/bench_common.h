@@ -0,0 +1,26 @@
+/*
+    Utilitários compartilhados pelos benchmarks.
+*/
+
+#pragma once
+
+#include "grid.h"
+#include <random>
+
+// Preenche o grid com entidades aleatórias, ocupando density das células
+template <typename Grid>
+void fill_grid(Grid &grid, uint32_t side, double density) {
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<> occupied(0.0, 1.0);
+    std::uniform_int_distribution<> type_distribution(plant, carnivore);
+    std::uniform_int_distribution<> age_distribution(0, 49);
+    grid.assign(side, side, {empty, 0, 0});
+    for (uint32_t i = 0; i < side; i++) {
+        for (uint32_t j = 0; j < side; j++) {
+            if (occupied(generator) < density) {
+                entity_type_t type = (entity_type_t)type_distribution(generator);
+                grid.set(i, j, {type, type == plant ? 0 : 100, age_distribution(generator)});
+            }
+        }
+    }
+}
@@ -0,0 +1,60 @@
+/*
+    Comparação entre as representações do grid (aos, packed e soa) nos dois
+    padrões de acesso da iteração: varredura dos tipos dos vizinhos e leitura
+    completa de cada célula.
+*/
+
+#include "bench_common.h"
+#include "grid.h"
+#include <benchmark/benchmark.h>
+
+// Conta as células vazias na vizinhança de von Neumann de cada entidade
+template <typename Grid>
+static void BM_neighbour_scan(benchmark::State &state) {
+    Grid grid;
+    uint32_t side = state.range(0);
+    fill_grid(grid, side, 0.3);
+    for (auto _ : state) {
+        uint64_t available = 0;
+        for (uint32_t i = 0; i < grid.rows; i++) {
+            for (uint32_t j = 0; j < grid.columns; j++) {
+                if (grid.type(i, j) == empty) {
+                    continue;
+                }
+                available += (i + 1 < grid.rows && grid.type(i + 1, j) == empty);
+                available += (i > 0 && grid.type(i - 1, j) == empty);
+                available += (j + 1 < grid.columns && grid.type(i, j + 1) == empty);
+                available += (j > 0 && grid.type(i, j - 1) == empty);
+            }
+        }
+        benchmark::DoNotOptimize(available);
+    }
+    state.SetItemsProcessed(state.iterations() * grid.size());
+    state.SetBytesProcessed(state.iterations() * grid.size() * grid.cell_bytes());
+}
+BENCHMARK_TEMPLATE(BM_neighbour_scan, aos_grid_t)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_neighbour_scan, packed_grid_t)->Arg(256)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_neighbour_scan, soa_grid_t)->Arg(256)->Arg(1024)->Arg(4096);
+
+// Lê todas as células por completo (tipo, energia e idade)
+template <typename Grid>
+static void BM_full_cell_read(benchmark::State &state) {
+    Grid grid;
+    uint32_t side = state.range(0);
+    fill_grid(grid, side, 0.3);
+    for (auto _ : state) {
+        int64_t total = 0;
+        for (uint32_t i = 0; i < grid.rows; i++) {
+            for (uint32_t j = 0; j < grid.columns; j++) {
+                entity_t entity = grid.get(i, j);
+                total += entity.energy + entity.age;
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * grid.size());
+    state.SetBytesProcessed(state.iterations() * grid.size() * grid.cell_bytes());
+}
+BENCHMARK_TEMPLATE(BM_full_cell_read, aos_grid_t)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_full_cell_read, packed_grid_t)->Arg(1024)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_full_cell_read, soa_grid_t)->Arg(1024)->Arg(4096);
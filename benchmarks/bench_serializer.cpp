@@ -0,0 +1,74 @@
+/*
+    Serialização do grid em JSON: árvore nlohmann::json + dump() contra o
+    serializador direto, que escreve o mesmo texto em um buffer reaproveitado.
+    Em binário: o quadro completo e o quadro delta, com uma fração das células
+    alteradas.
+*/
+
+#include "bench_common.h"
+#include "serializer.h"
+#include <benchmark/benchmark.h>
+
+static void BM_grid_json_dom(benchmark::State &state) {
+    grid_t grid;
+    fill_grid(grid, state.range(0), 0.3);
+    size_t bytes = 0;
+    for (auto _ : state) {
+        nlohmann::json json_grid = grid;
+        std::string body = json_grid.dump();
+        bytes = body.size();
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetItemsProcessed(state.iterations() * grid.size());
+    state.SetBytesProcessed(state.iterations() * bytes);
+}
+BENCHMARK(BM_grid_json_dom)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_grid_json_stream(benchmark::State &state) {
+    grid_t grid;
+    fill_grid(grid, state.range(0), 0.3);
+    std::string body;
+    for (auto _ : state) {
+        body.clear();
+        write_grid_json(body, grid);
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetItemsProcessed(state.iterations() * grid.size());
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_grid_json_stream)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+static void BM_grid_binary(benchmark::State &state) {
+    grid_t grid;
+    fill_grid(grid, state.range(0), 0.3);
+    std::string body;
+    for (auto _ : state) {
+        body.clear();
+        write_grid_binary(body, grid, 1);
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetItemsProcessed(state.iterations() * grid.size());
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_grid_binary)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+// Delta com range(1)% das células alteradas, espalhadas pelo grid
+static void BM_delta_binary(benchmark::State &state) {
+    grid_t grid;
+    fill_grid(grid, state.range(0), 0.3);
+    std::vector<uint32_t> changes;
+    for (uint32_t index = 0; index < grid.size(); index++) {
+        if (index * state.range(1) / 100 != (index + 1) * state.range(1) / 100) {
+            changes.push_back(index);
+        }
+    }
+    std::string body;
+    for (auto _ : state) {
+        body.clear();
+        write_delta_binary(body, grid, changes, 0, 1);
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetItemsProcessed(state.iterations() * changes.size());
+    state.SetBytesProcessed(state.iterations() * body.size());
+}
+BENCHMARK(BM_delta_binary)->ArgsProduct({{64, 256, 1024}, {1, 10, 40}})->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,139 @@
+/*
+    Núcleo da simulação: uma iteração completa em vários tamanhos e
+    densidades de grid, o comportamento de cada tipo de entidade isolado e a
+    preparação feita pelo /start-simulation (parse do body, colocação das
+    entidades e serialização do grid inicial).
+
+    Todas as simulações usam a semente BENCH_SEED, então cada execução mede
+    exatamente o mesmo trabalho e os números são comparáveis entre commits.
+*/
+
+#include "json.hpp"
+#include "serializer.h"
+#include "simulation.h"
+#include "thread_pool.h"
+#include <benchmark/benchmark.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const uint64_t BENCH_SEED = 42;
+// Iterações avançadas antes da medição, para sair da colocação inicial uniforme
+static const uint64_t WARMUP_TICKS = 10;
+
+// Prepara a simulação com density das células ocupadas, na proporção de 4 plantas
+// para 3 herbívoros e 1 carnívoro
+static void setup_bench_simulation(simulation_t &sim, uint32_t side, double density, update_mode_t mode) {
+    uint32_t entities = (uint32_t)(side * side * density);
+    setup_simulation(sim, side, side, entities / 2, entities * 3 / 8, entities / 8, BENCH_SEED, mode, rules_t());
+}
+
+// Uma iteração a partir do mesmo estado: o grid e a iteração são restaurados a cada
+// repetição. Com History, a iteração também registra o mapa das células ocupadas
+// usado pelas respostas delta, como no servidor; sem ele, mede só a simulação, como
+// no ecosim-batch. Argumentos: lado do grid e densidade em porcentagem.
+template <typename Advance>
+static void measure_tick(benchmark::State &state, update_mode_t mode, bool history, Advance advance) {
+    simulation_t sim;
+    sim.record_history = history;
+    setup_bench_simulation(sim, state.range(0), state.range(1) / 100.0, mode);
+    for (uint64_t k = 0; k < WARMUP_TICKS; k++) {
+        advance(sim);
+    }
+    grid_t initial = sim.grid;
+    uint64_t initial_tick = sim.tick;
+    population_t population = count_population(sim.grid);
+    for (auto _ : state) {
+        state.PauseTiming();
+        sim.grid = initial;
+        sim.tick = initial_tick;
+        state.ResumeTiming();
+        advance(sim);
+    }
+    state.SetItemsProcessed(state.iterations() * (population.plants + population.herbivores + population.carnivores));
+    state.counters["entities"] = population.plants + population.herbivores + population.carnivores;
+}
+
+// Inline avança na thread do benchmark, sem pool
+template <update_mode_t Mode, bool Inline, bool History>
+static void BM_tick(benchmark::State &state) {
+    if constexpr (Inline) {
+        measure_tick(state, Mode, History, [](simulation_t &sim) { advance_simulation(sim); });
+    } else {
+        thread_pool_t pool(std::thread::hardware_concurrency());
+        measure_tick(state, Mode, History, [&pool](simulation_t &sim) { advance_simulation(sim, pool); });
+    }
+}
+static void tick_arguments(benchmark::internal::Benchmark *benchmark) {
+    for (int side : {64, 256, 1024}) {
+        for (int density : {10, 30, 60}) {
+            benchmark->Args({side, density});
+        }
+    }
+    benchmark->Unit(benchmark::kMillisecond);
+}
+BENCHMARK_TEMPLATE(BM_tick, sequential, false, false)->Apply(tick_arguments);
+BENCHMARK_TEMPLATE(BM_tick, sequential, true, false)->Apply(tick_arguments);
+BENCHMARK_TEMPLATE(BM_tick, checkerboard, false, false)->Apply(tick_arguments);
+BENCHMARK_TEMPLATE(BM_tick, checkerboard, true, false)->Apply(tick_arguments);
+// O caminho do servidor, com o histórico das respostas delta
+BENCHMARK_TEMPLATE(BM_tick, sequential, false, true)->Apply(tick_arguments);
+BENCHMARK_TEMPLATE(BM_tick, checkerboard, false, true)->Apply(tick_arguments);
+
+// Comportamento de um tipo de entidade isolado: todas as entidades desse tipo são
+// atualizadas uma vez, sem as dos outros tipos, a partir do mesmo estado
+template <entity_type_t Type, void (*Behavior)(simulation_t &, uint32_t, uint32_t)>
+static void BM_entity(benchmark::State &state) {
+    simulation_t sim;
+    setup_bench_simulation(sim, state.range(0), 0.3, sequential);
+    for (uint64_t k = 0; k < WARMUP_TICKS; k++) {
+        advance_simulation(sim);
+    }
+    std::vector<pos_t> positions;
+    for (uint32_t i = 0; i < sim.grid.rows; i++) {
+        for (uint32_t j = 0; j < sim.grid.columns; j++) {
+            if (sim.grid.type(i, j) == Type) {
+                positions.push_back({i, j});
+            }
+        }
+    }
+    grid_t initial = sim.grid;
+    for (auto _ : state) {
+        state.PauseTiming();
+        sim.grid = initial;
+        sim.analyzed_cells.clear();
+        state.ResumeTiming();
+        for (const pos_t &position : positions) {
+            // Um herbívoro ou carnívoro que se moveu pode ter saído da posição
+            if (sim.grid.type(position.i, position.j) == Type) {
+                Behavior(sim, position.i, position.j);
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * positions.size());
+}
+BENCHMARK_TEMPLATE(BM_entity, plant, plant_thread)->Arg(256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_entity, herbivore, herbivore_thread)->Arg(256)->Unit(benchmark::kMicrosecond);
+BENCHMARK_TEMPLATE(BM_entity, carnivore, carnivore_thread)->Arg(256)->Unit(benchmark::kMicrosecond);
+
+// Trabalho do /start-simulation sem a camada HTTP: parse do body, colocação das
+// entidades e serialização do grid inicial em JSON
+static void BM_start_simulation(benchmark::State &state) {
+    uint32_t side = state.range(0);
+    uint32_t entities = side * side * 3 / 10;
+    std::string request = "{\"width\":" + std::to_string(side) + ",\"height\":" + std::to_string(side) + ",\"plants\":" + std::to_string(entities / 2) +
+                          ",\"herbivores\":" + std::to_string(entities * 3 / 8) + ",\"carnivores\":" + std::to_string(entities / 8) +
+                          ",\"seed\":" + std::to_string(BENCH_SEED) + "}";
+    std::string body;
+    for (auto _ : state) {
+        nlohmann::json request_body = nlohmann::json::parse(request);
+        simulation_t sim;
+        setup_simulation(sim, request_body["height"], request_body["width"], request_body["plants"], request_body["herbivores"],
+                         request_body["carnivores"], request_body["seed"], sequential, rules_t());
+        body.clear();
+        write_grid_json(body, sim.grid);
+        benchmark::DoNotOptimize(body.data());
+    }
+    state.SetItemsProcessed(state.iterations() * side * side);
+}
+BENCHMARK(BM_start_simulation)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
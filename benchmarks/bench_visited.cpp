@@ -0,0 +1,73 @@
+/*
+    Custo da verificação "a célula já foi analisada nesta iteração?" em grids
+    grandes: busca linear no vetor de posições (implementação original) contra
+    o visited_set_t com gerações.
+*/
+
+#include "visited_set.h"
+#include <benchmark/benchmark.h>
+#include <random>
+#include <utility>
+#include <vector>
+
+// Fração das células marcadas por iteração (nascimentos + movimentos)
+static const uint32_t MARKED_PER_CELLS = 100;
+
+static std::vector<std::pair<uint32_t, uint32_t>> random_positions(uint32_t side, size_t count) {
+    std::mt19937 generator(42);
+    std::uniform_int_distribution<uint32_t> distribution(0, side - 1);
+    std::vector<std::pair<uint32_t, uint32_t>> positions(count);
+    for (auto &position : positions) {
+        position = std::make_pair(distribution(generator), distribution(generator));
+    }
+    return positions;
+}
+
+static void BM_analyzed_linear_scan(benchmark::State &state) {
+    uint32_t side = state.range(0);
+    std::vector<std::pair<uint32_t, uint32_t>> analyzed_pos = random_positions(side, size_t(side) * side / MARKED_PER_CELLS);
+    uint32_t i = 0, j = 0;
+    for (auto _ : state) {
+        bool analyzed = false;
+        for (size_t k = 0; k < analyzed_pos.size(); k++) {
+            if (analyzed_pos[k].first == i && analyzed_pos[k].second == j) {
+                analyzed = true;
+            }
+        }
+        benchmark::DoNotOptimize(analyzed);
+        if (++j == side) {
+            j = 0;
+            i = (i + 1) % side;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_analyzed_linear_scan)->Arg(100)->Arg(300)->Arg(1000);
+
+static void BM_analyzed_visited_set(benchmark::State &state) {
+    uint32_t side = state.range(0);
+    visited_set_t analyzed_cells;
+    analyzed_cells.resize(size_t(side) * side);
+    for (const auto &position : random_positions(side, size_t(side) * side / MARKED_PER_CELLS)) {
+        analyzed_cells.insert(size_t(position.first) * side + position.second);
+    }
+    size_t index = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(analyzed_cells.contains(index));
+        if (++index == size_t(side) * side) {
+            index = 0;
+        }
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_analyzed_visited_set)->Arg(100)->Arg(300)->Arg(1000);
+
+static void BM_analyzed_visited_set_clear(benchmark::State &state) {
+    uint32_t side = state.range(0);
+    visited_set_t analyzed_cells;
+    analyzed_cells.resize(size_t(side) * side);
+    for (auto _ : state) {
+        analyzed_cells.clear();
+    }
+}
+BENCHMARK(BM_analyzed_visited_set_clear)->Arg(1000);
@@ -0,0 +1,29 @@
+/*
+    Relatório da memória ocupada pelo grid para alguns tamanhos de mundo,
+    em cada representação de célula, incluindo o visited_set_t da iteração.
+*/
+
+#include "grid.h"
+#include <cstdio>
+
+static double to_mib(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+int main() {
+    const uint32_t sides[] = {15, 1000, 4096, 10000};
+    const size_t stamp_bytes = sizeof(uint32_t);
+
+    std::printf("%-13s %14s %14s %14s %14s %16s\n", "grid", "cells", "aos (MiB)", "packed (MiB)", "soa (MiB)", "visited (MiB)");
+    for (uint32_t side : sides) {
+        grid_shape_t shape;
+        shape.rows = side;
+        shape.columns = side;
+        std::printf("%5ux%-7u %14zu %14.1f %14.1f %14.1f %16.1f\n", side, side, shape.size(),
+                    to_mib(shape.size() * aos_grid_t().cell_bytes()),
+                    to_mib(shape.size() * packed_grid_t().cell_bytes()),
+                    to_mib(shape.size() * soa_grid_t().cell_bytes()),
+                    to_mib(shape.size() * stamp_bytes));
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+/*
+    Teste de carga do servidor: cada conexão cria a sua própria sessão e pede
+    /next-iteration em laço, com keep-alive, durante um tempo fixo. Para cada
+    número de conexões simultâneas, mostra as requisições por segundo e a
+    latência (mediana e p99).
+
+    Uso: ecosim-load-test [--host 127.0.0.1] [--port 8080] [--connections 1,2,4,8]
+                          [--seconds 5] [--side 64] [--density 0.3] [--mode sequential]
+    O servidor deve estar rodando (ecosim --http-threads N).
+*/
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+struct options_t {
+    std::string host = "127.0.0.1";
+    int port = 8080;
+    std::vector<int> connections = {1, 2, 4, 8};
+    double seconds = 5;
+    unsigned side = 64;
+    double density = 0.3;
+    std::string mode = "sequential";
+};
+
+struct http_response_t {
+    int status = 0;
+    std::string session;
+    std::string body;
+};
+
+// Conexão HTTP/1.1 persistente e bloqueante
+class http_connection_t {
+public:
+    ~http_connection_t() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    bool connect_to(const std::string &host, int port) {
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (fd < 0 || inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1 ||
+            connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+            return false;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        return true;
+    }
+
+    bool request(const std::string &method, const std::string &path, const std::string &body, http_response_t &response) {
+        std::string message = method + " " + path + " HTTP/1.1\r\nHost: localhost\r\nAccept: application/octet-stream\r\n";
+        if (!body.empty()) {
+            message += "Content-Type: application/json\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+        }
+        message += "\r\n" + body;
+        for (size_t sent = 0; sent < message.size();) {
+            ssize_t written = send(fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) {
+                return false;
+            }
+            sent += written;
+        }
+        // Lê o cabeçalho e depois exatamente Content-Length bytes de corpo
+        size_t header_end;
+        while ((header_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            if (!receive()) {
+                return false;
+            }
+        }
+        std::string header = buffer.substr(0, header_end);
+        response.status = std::atoi(header.c_str() + header.find(' ') + 1);
+        response.session = header_value(header, "x-ecosim-session");
+        size_t length = std::strtoull(header_value(header, "content-length").c_str(), nullptr, 10);
+        while (buffer.size() < header_end + 4 + length) {
+            if (!receive()) {
+                return false;
+            }
+        }
+        response.body = buffer.substr(header_end + 4, length);
+        buffer.erase(0, header_end + 4 + length);
+        return true;
+    }
+
+private:
+    bool receive() {
+        char chunk[65536];
+        ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+        if (count <= 0) {
+            return false;
+        }
+        buffer.append(chunk, count);
+        return true;
+    }
+
+    // Valor de um campo do cabeçalho (nome em minúsculas), ou "" se ele não existir
+    static std::string header_value(const std::string &header, const std::string &name) {
+        std::string lower = header;
+        std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+        size_t position = lower.find("\r\n" + name + ":");
+        if (position == std::string::npos) {
+            return "";
+        }
+        size_t begin = header.find_first_not_of(' ', position + name.size() + 3);
+        return header.substr(begin, header.find("\r\n", begin) - begin);
+    }
+
+    int fd = -1;
+    std::string buffer;
+};
+
+struct run_result_t {
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    std::vector<double> latencies_ms;
+};
+
+// Uma conexão: cria a sessão e avança iterações até o fim do prazo
+static void run_connection(const options_t &options, unsigned index, std::chrono::steady_clock::time_point deadline, run_result_t &result) {
+    http_connection_t connection;
+    if (!connection.connect_to(options.host, options.port)) {
+        result.failures++;
+        return;
+    }
+    unsigned entities = (unsigned)(options.side * options.side * options.density);
+    std::string body = "{\"width\":" + std::to_string(options.side) + ",\"height\":" + std::to_string(options.side) +
+                       ",\"plants\":" + std::to_string(entities / 2) + ",\"herbivores\":" + std::to_string(entities * 3 / 8) +
+                       ",\"carnivores\":" + std::to_string(entities / 8) + ",\"seed\":" + std::to_string(42 + index) +
+                       ",\"mode\":\"" + options.mode + "\"}";
+    http_response_t response;
+    if (!connection.request("POST", "/start-simulation", body, response) || response.status != 200 || response.session.empty()) {
+        result.failures++;
+        return;
+    }
+    std::string path = "/next-iteration?session=" + response.session;
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        if (!connection.request("GET", path, "", response) || response.status != 200) {
+            result.failures++;
+            return;
+        }
+        result.requests++;
+        result.latencies_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+}
+
+static double percentile(std::vector<double> &values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t position = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + position, values.end());
+    return values[position];
+}
+
+static bool parse_options(int argc, char **argv, options_t &options) {
+    for (int k = 1; k + 1 < argc; k += 2) {
+        std::string name = argv[k];
+        const char *value = argv[k + 1];
+        if (name == "--host") {
+            options.host = value;
+        } else if (name == "--port") {
+            options.port = std::atoi(value);
+        } else if (name == "--seconds") {
+            options.seconds = std::atof(value);
+        } else if (name == "--side") {
+            options.side = std::atoi(value);
+        } else if (name == "--density") {
+            options.density = std::atof(value);
+        } else if (name == "--mode") {
+            options.mode = value;
+        } else if (name == "--connections") {
+            options.connections.clear();
+            for (const char *cursor = value; *cursor != '\0';) {
+                char *end;
+                options.connections.push_back((int)std::strtol(cursor, &end, 10));
+                cursor = *end == ',' ? end + 1 : end;
+                if (options.connections.back() <= 0 || (*end != ',' && *end != '\0')) {
+                    return false;
+                }
+            }
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1;
+}
+
+int main(int argc, char **argv) {
+    options_t options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--host H] [--port P] [--connections 1,2,4] [--seconds S] [--side N] [--density D] [--mode M]\n", argv[0]);
+        return 1;
+    }
+    std::printf("%dx%d grid, density %.2f, %s mode, %.1f s per run\n", options.side, options.side, options.density, options.mode.c_str(), options.seconds);
+    std::printf("%12s %12s %12s %12s %10s\n", "connections", "requests/s", "p50 (ms)", "p99 (ms)", "failures");
+    for (int connections : options.connections) {
+        std::vector<run_result_t> results(connections);
+        std::vector<std::thread> threads;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::chrono::steady_clock::time_point deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(options.seconds));
+        for (int k = 0; k < connections; k++) {
+            threads.emplace_back(run_connection, std::cref(options), (unsigned)k, deadline, std::ref(results[k]));
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        run_result_t total;
+        for (run_result_t &result : results) {
+            total.requests += result.requests;
+            total.failures += result.failures;
+            total.latencies_ms.insert(total.latencies_ms.end(), result.latencies_ms.begin(), result.latencies_ms.end());
+        }
+        std::printf("%12d %12.0f %12.2f %12.2f %10llu\n", connections, total.requests / elapsed, percentile(total.latencies_ms, 0.5),
+                    percentile(total.latencies_ms, 0.99), (unsigned long long)total.failures);
+    }
+    return 0;
+}
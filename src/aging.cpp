@@ -0,0 +1,206 @@
+#include "aging.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define ECOSIM_AVX2_KERNELS
+#include <immintrin.h>
+#endif
+
+// Regra de uma célula, compartilhada pelas versões escalares
+static bool entity_dies(entity_type_t type, int32_t energy, int32_t age, const aging_rules_t &rules) {
+    return age == rules.maximum_age[type] || (rules.starves[type] && energy <= 0);
+}
+
+size_t age_entities_scalar(aos_grid_t &grid, const aging_rules_t &rules) {
+    size_t deaths = 0;
+    for (entity_t &entity : grid.cells) {
+        if (entity.type == empty) {
+            continue;
+        }
+        if (entity_dies(entity.type, entity.energy, entity.age, rules)) {
+            entity = {empty, 0, 0};
+            deaths++;
+        } else {
+            entity.age++;
+        }
+    }
+    return deaths;
+}
+
+size_t age_entities_scalar(packed_grid_t &grid, const aging_rules_t &rules) {
+    size_t deaths = 0;
+    for (packed_cell_t &cell : grid.cells) {
+        entity_type_t type = cell.type();
+        if (type == empty) {
+            continue;
+        }
+        if (entity_dies(type, cell.energy(), cell.age(), rules)) {
+            cell = packed_cell_t::pack({empty, 0, 0});
+            deaths++;
+        } else {
+            cell.bits += 1u << packed_cell_t::TYPE_BITS;
+        }
+    }
+    return deaths;
+}
+
+size_t age_entities_scalar(soa_grid_t &grid, const aging_rules_t &rules) {
+    size_t deaths = 0;
+    for (size_t k = 0; k < grid.size(); k++) {
+        entity_type_t type = (entity_type_t)grid.types[k];
+        if (type == empty) {
+            continue;
+        }
+        if (entity_dies(type, grid.energies[k], grid.ages[k], rules)) {
+            grid.types[k] = empty;
+            grid.energies[k] = 0;
+            grid.ages[k] = 0;
+            deaths++;
+        } else {
+            grid.ages[k]++;
+        }
+    }
+    return deaths;
+}
+
+#ifdef ECOSIM_AVX2_KERNELS
+
+// Oito células compactadas por vez; a idade nunca passa de 127, então somar
+// 1 << TYPE_BITS incrementa a idade sem invadir os bits da energia
+__attribute__((target("avx2"))) static size_t age_entities_avx2(packed_grid_t &grid, const aging_rules_t &rules) {
+    const __m256i type_mask = _mm256_set1_epi32(packed_cell_t::TYPE_MASK);
+    const __m256i age_mask = _mm256_set1_epi32(packed_cell_t::AGE_MASK);
+    const __m256i age_increment = _mm256_set1_epi32(1 << packed_cell_t::TYPE_BITS);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i limits = _mm256_setr_epi32(rules.maximum_age[0], rules.maximum_age[1], rules.maximum_age[2], rules.maximum_age[3],
+                                             rules.maximum_age[0], rules.maximum_age[1], rules.maximum_age[2], rules.maximum_age[3]);
+    const __m256i starves = _mm256_setr_epi32(-rules.starves[0], -rules.starves[1], -rules.starves[2], -rules.starves[3],
+                                              -rules.starves[0], -rules.starves[1], -rules.starves[2], -rules.starves[3]);
+    uint32_t *bits = reinterpret_cast<uint32_t *>(grid.cells.data());
+    size_t count = grid.size();
+    size_t deaths = 0;
+    size_t k = 0;
+    for (; k + 8 <= count; k += 8) {
+        __m256i cells = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(bits + k));
+        __m256i types = _mm256_and_si256(cells, type_mask);
+        __m256i ages = _mm256_and_si256(_mm256_srli_epi32(cells, packed_cell_t::TYPE_BITS), age_mask);
+        __m256i energies = _mm256_srai_epi32(cells, packed_cell_t::ENERGY_SHIFT);
+        __m256i occupied = _mm256_xor_si256(_mm256_cmpeq_epi32(types, zero), _mm256_set1_epi32(-1));
+        __m256i too_old = _mm256_cmpeq_epi32(ages, _mm256_permutevar8x32_epi32(limits, types));
+        __m256i starved = _mm256_and_si256(_mm256_permutevar8x32_epi32(starves, types), _mm256_cmpgt_epi32(one, energies));
+        __m256i dead = _mm256_and_si256(occupied, _mm256_or_si256(too_old, starved));
+        __m256i aged = _mm256_add_epi32(cells, _mm256_and_si256(occupied, age_increment));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(bits + k), _mm256_andnot_si256(dead, aged));
+        deaths += __builtin_popcount(_mm256_movemask_ps(_mm256_castsi256_ps(dead)));
+    }
+    for (; k < count; k++) {
+        packed_cell_t &cell = grid.cells[k];
+        entity_type_t type = cell.type();
+        if (type == empty) {
+            continue;
+        }
+        if (entity_dies(type, cell.energy(), cell.age(), rules)) {
+            cell = packed_cell_t::pack({empty, 0, 0});
+            deaths++;
+        } else {
+            cell.bits += 1u << packed_cell_t::TYPE_BITS;
+        }
+    }
+    return deaths;
+}
+
+// 32 células por vez: tipos e idades em bytes, energias em quatro vetores de 8
+__attribute__((target("avx2"))) static size_t age_entities_avx2(soa_grid_t &grid, const aging_rules_t &rules) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi32(1);
+    // Tabelas indexadas pelo tipo (0 a 3) via pshufb; o vazio nunca morre
+    const __m256i limits = _mm256_setr_epi8(-1, (char)rules.maximum_age[1], (char)rules.maximum_age[2], (char)rules.maximum_age[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                            -1, (char)rules.maximum_age[1], (char)rules.maximum_age[2], (char)rules.maximum_age[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i starves = _mm256_setr_epi8(0, -rules.starves[1], -rules.starves[2], -rules.starves[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                             0, -rules.starves[1], -rules.starves[2], -rules.starves[3], 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    // Reordena os bytes do empacotamento de 4 vetores de 32 bits de volta à ordem das células
+    const __m256i pack_order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t count = grid.size();
+    size_t deaths = 0;
+    size_t k = 0;
+    for (; k + 32 <= count; k += 32) {
+        __m256i types = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(grid.types.data() + k));
+        __m256i ages = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(grid.ages.data() + k));
+        int32_t *energies = grid.energies.data() + k;
+        __m256i starving[4];
+        for (int part = 0; part < 4; part++) {
+            __m256i energy = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(energies + part * 8));
+            starving[part] = _mm256_cmpgt_epi32(one, energy);
+        }
+        __m256i starving_bytes = _mm256_permutevar8x32_epi32(
+            _mm256_packs_epi16(_mm256_packs_epi32(starving[0], starving[1]), _mm256_packs_epi32(starving[2], starving[3])), pack_order);
+        __m256i occupied = _mm256_xor_si256(_mm256_cmpeq_epi8(types, zero), _mm256_set1_epi8(-1));
+        __m256i too_old = _mm256_cmpeq_epi8(ages, _mm256_shuffle_epi8(limits, types));
+        __m256i starved = _mm256_and_si256(_mm256_shuffle_epi8(starves, types), starving_bytes);
+        __m256i dead = _mm256_and_si256(occupied, _mm256_or_si256(too_old, starved));
+        // occupied vale -1 nas células ocupadas, então subtraí-lo incrementa a idade
+        __m256i aged = _mm256_sub_epi8(ages, occupied);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(grid.types.data() + k), _mm256_andnot_si256(dead, types));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(grid.ages.data() + k), _mm256_andnot_si256(dead, aged));
+        uint32_t dead_mask = (uint32_t)_mm256_movemask_epi8(dead);
+        if (dead_mask != 0) {
+            // Mortes são raras: zera a energia só das células que morreram
+            deaths += __builtin_popcount(dead_mask);
+            while (dead_mask != 0) {
+                energies[__builtin_ctz(dead_mask)] = 0;
+                dead_mask &= dead_mask - 1;
+            }
+        }
+    }
+    for (; k < count; k++) {
+        entity_type_t type = (entity_type_t)grid.types[k];
+        if (type == empty) {
+            continue;
+        }
+        if (entity_dies(type, grid.energies[k], grid.ages[k], rules)) {
+            grid.types[k] = empty;
+            grid.energies[k] = 0;
+            grid.ages[k] = 0;
+            deaths++;
+        } else {
+            grid.ages[k]++;
+        }
+    }
+    return deaths;
+}
+
+bool aging_uses_avx2() {
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+}
+
+#else
+
+bool aging_uses_avx2() {
+    return false;
+}
+
+#endif
+
+// O layout aos intercala 12 bytes por célula e não tem versão vetorizada
+size_t age_entities(aos_grid_t &grid, const aging_rules_t &rules) {
+    return age_entities_scalar(grid, rules);
+}
+
+size_t age_entities(packed_grid_t &grid, const aging_rules_t &rules) {
+#ifdef ECOSIM_AVX2_KERNELS
+    if (aging_uses_avx2()) {
+        return age_entities_avx2(grid, rules);
+    }
+#endif
+    return age_entities_scalar(grid, rules);
+}
+
+size_t age_entities(soa_grid_t &grid, const aging_rules_t &rules) {
+#ifdef ECOSIM_AVX2_KERNELS
+    if (aging_uses_avx2()) {
+        return age_entities_avx2(grid, rules);
+    }
+#endif
+    return age_entities_scalar(grid, rules);
+}
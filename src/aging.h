@@ -0,0 +1,33 @@
+/*
+    Passo de envelhecimento e morte, executado sobre o grid inteiro no
+    início de cada iteração, antes do comportamento das entidades.
+
+    Para cada célula ocupada: se a entidade atingiu a idade máxima do seu
+    tipo, ou se é um animal sem energia, a célula fica vazia; caso contrário
+    a idade é incrementada. Nos layouts packed e soa o passo usa AVX2 quando
+    o processador suporta, com uma versão escalar equivalente como reserva.
+*/
+
+#pragma once
+
+#include "grid.h"
+
+struct aging_rules_t {
+    // Idade em que cada tipo de entidade morre, indexada por entity_type_t
+    int32_t maximum_age[4];
+    // Se o tipo morre quando a energia chega a 0, indexado por entity_type_t
+    bool starves[4];
+};
+
+// Retornam o número de entidades que morreram
+size_t age_entities(aos_grid_t &grid, const aging_rules_t &rules);
+size_t age_entities(packed_grid_t &grid, const aging_rules_t &rules);
+size_t age_entities(soa_grid_t &grid, const aging_rules_t &rules);
+
+// Versões escalares, usadas como reserva e para comparação nos benchmarks
+size_t age_entities_scalar(aos_grid_t &grid, const aging_rules_t &rules);
+size_t age_entities_scalar(packed_grid_t &grid, const aging_rules_t &rules);
+size_t age_entities_scalar(soa_grid_t &grid, const aging_rules_t &rules);
+
+// Indica se o processador atual executa os kernels AVX2
+bool aging_uses_avx2();
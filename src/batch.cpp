@@ -0,0 +1,469 @@
+/*
+    Execução da simulação em lote, sem o servidor HTTP.
+
+    Uso: ecosim-batch --width W --height H --plants P --herbivores H --carnivores C
+                      --seed S --ticks T [--mode sequential|checkerboard]
+                      [--output arquivo.csv] [--threads N] [--replicas R]
+                      [--rule nome=valor]... [--sweep nome=início:fim:passo]...
+                      [--checkpoint arquivo] [--snapshot arquivo] [--restore arquivo]
+
+    Escreve a série temporal da população em CSV (tick,plants,herbivores,carnivores),
+    da iteração 0 (colocação inicial) até a iteração T. Sem --output, escreve na
+    saída padrão.
+
+    Com --replicas R, roda um conjunto (ensemble) de R simulações independentes,
+    com as sementes S, S + 1, ..., S + R - 1, e escreve por iteração a média, a
+    variância amostral e os quantis 5%, 50% e 95% de cada população entre as
+    réplicas (colunas plants_mean, plants_variance, plants_p05, plants_p50,
+    plants_p95 e o mesmo para herbivores e carnivores).
+
+    --rule altera um parâmetro das regras (ver rules.h). Com --sweep, que também
+    aceita uma lista de valores (nome=v1,v2,...), o ecosim-batch varre todas as
+    combinações dos parâmetros indicados: cada combinação roda R réplicas (1 sem
+    --replicas) até a iteração T, e a saída tem uma linha por combinação, com os
+    valores dos parâmetros varridos e, para cada população na iteração final, as
+    mesmas estatísticas do ensemble e a fração de réplicas em que ela se extinguiu
+    (plants_extinct etc.).
+
+    --checkpoint grava o estado da simulação ao fim da execução, e --restore
+    começa a partir de um checkpoint gravado (ver checkpoint.h) em vez de
+    colocar as entidades: o grid, a iteração, a semente, o modo e as regras
+    vêm do arquivo, e a série vai da iteração restaurada até T. Uma execução
+    até T retomada de um checkpoint na iteração K < T escreve as mesmas
+    linhas que a execução contínua a partir de K. --snapshot grava o estado
+    final como um snapshot para mmap (ver snapshot.h), que o --restore também
+    aceita, conferindo o checksum das células. Essas opções valem só para uma
+    simulação (sem --replicas nem --sweep).
+*/
+
+#include "checkpoint.h"
+#include "grid.h"
+#include "rules.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Iterações que cada réplica avança por tarefa do pool antes de agregar as populações
+static const uint64_t ENSEMBLE_BLOCK_TICKS = 64;
+// Limite do número de combinações de uma varredura
+static const uint64_t MAXIMUM_SWEEP_COMBINATIONS = 1000000;
+
+// Parâmetro varrido e os seus valores
+struct sweep_axis_t {
+    const rule_field_t *field;
+    std::vector<double> values;
+};
+
+struct batch_options_t {
+    uint32_t width = 15;
+    uint32_t height = 15;
+    uint32_t plants = 0;
+    uint32_t herbivores = 0;
+    uint32_t carnivores = 0;
+    uint64_t seed = 0;
+    uint64_t ticks = 0;
+    update_mode_t mode = sequential;
+    std::string output;
+    unsigned threads = std::thread::hardware_concurrency();
+    // 0: uma única simulação, com a série temporal completa
+    uint32_t replicas = 0;
+    rules_t rules;
+    std::vector<sweep_axis_t> sweeps;
+    std::string checkpoint;
+    std::string snapshot;
+    std::string restore;
+};
+
+static bool parse_unsigned(const char *text, uint64_t maximum, uint64_t &value) {
+    char *end;
+    errno = 0;
+    value = std::strtoull(text, &end, 10);
+    return *text != '\0' && *text != '-' && *end == '\0' && errno == 0 && value <= maximum;
+}
+
+// Lê "nome=valor" de --rule
+static bool parse_rule(const char *text, rules_t &rules) {
+    const char *separator = std::strchr(text, '=');
+    if (separator == nullptr) {
+        return false;
+    }
+    const rule_field_t *field = find_rule(std::string(text, separator));
+    char *end;
+    double value = std::strtod(separator + 1, &end);
+    if (field == nullptr || separator[1] == '\0' || *end != '\0' || !rule_accepts(*field, value)) {
+        return false;
+    }
+    set_rule(rules, *field, value);
+    return true;
+}
+
+// Lê "nome=início:fim:passo" ou "nome=v1,v2,..." de --sweep
+static bool parse_sweep(const char *text, std::vector<sweep_axis_t> &sweeps) {
+    const char *separator = std::strchr(text, '=');
+    if (separator == nullptr) {
+        return false;
+    }
+    sweep_axis_t axis = {find_rule(std::string(text, separator)), {}};
+    if (axis.field == nullptr) {
+        return false;
+    }
+    for (const sweep_axis_t &other : sweeps) {
+        if (other.field == axis.field) {
+            return false;
+        }
+    }
+    std::vector<double> numbers;
+    char delimiter = '\0';
+    for (const char *cursor = separator + 1;;) {
+        char *end;
+        numbers.push_back(std::strtod(cursor, &end));
+        if (end == cursor || (*end != '\0' && *end != ':' && *end != ',') || (delimiter != '\0' && *end != '\0' && *end != delimiter)) {
+            return false;
+        }
+        if (*end == '\0') {
+            break;
+        }
+        delimiter = *end;
+        cursor = end + 1;
+    }
+    if (delimiter == ':') {
+        // Faixa: os valores são calculados a partir do início, sem acumular o passo
+        if (numbers.size() != 3 || numbers[2] <= 0 || numbers[1] < numbers[0]) {
+            return false;
+        }
+        double steps = std::floor((numbers[1] - numbers[0]) / numbers[2] + 1e-9);
+        if (steps >= MAXIMUM_SWEEP_COMBINATIONS) {
+            return false;
+        }
+        for (uint64_t k = 0; k <= (uint64_t)steps; k++) {
+            axis.values.push_back(numbers[0] + k * numbers[2]);
+        }
+    } else {
+        axis.values = numbers;
+    }
+    for (double value : axis.values) {
+        if (!rule_accepts(*axis.field, value)) {
+            return false;
+        }
+    }
+    sweeps.push_back(std::move(axis));
+    return true;
+}
+
+static bool parse_options(int argc, char **argv, batch_options_t &options) {
+    for (int k = 1; k < argc; k += 2) {
+        if (k + 1 >= argc) {
+            return false;
+        }
+        std::string name = argv[k];
+        const char *text = argv[k + 1];
+        uint64_t value = 0;
+        bool ok = true;
+        if (name == "--width") {
+            ok = parse_unsigned(text, UINT32_MAX, value) && value > 0;
+            options.width = value;
+        } else if (name == "--height") {
+            ok = parse_unsigned(text, UINT32_MAX, value) && value > 0;
+            options.height = value;
+        } else if (name == "--plants") {
+            ok = parse_unsigned(text, UINT32_MAX, value);
+            options.plants = value;
+        } else if (name == "--herbivores") {
+            ok = parse_unsigned(text, UINT32_MAX, value);
+            options.herbivores = value;
+        } else if (name == "--carnivores") {
+            ok = parse_unsigned(text, UINT32_MAX, value);
+            options.carnivores = value;
+        } else if (name == "--seed") {
+            ok = parse_unsigned(text, UINT64_MAX, options.seed);
+        } else if (name == "--ticks") {
+            ok = parse_unsigned(text, UINT64_MAX, options.ticks);
+        } else if (name == "--threads") {
+            ok = parse_unsigned(text, 4096, value) && value > 0;
+            options.threads = value;
+        } else if (name == "--replicas") {
+            ok = parse_unsigned(text, 65536, value) && value > 0;
+            options.replicas = value;
+        } else if (name == "--rule") {
+            ok = parse_rule(text, options.rules);
+        } else if (name == "--sweep") {
+            ok = parse_sweep(text, options.sweeps);
+        } else if (name == "--output") {
+            options.output = text;
+        } else if (name == "--checkpoint") {
+            options.checkpoint = text;
+        } else if (name == "--snapshot") {
+            options.snapshot = text;
+        } else if (name == "--restore") {
+            options.restore = text;
+        } else if (name == "--mode") {
+            ok = std::strcmp(text, "sequential") == 0 || std::strcmp(text, "checkerboard") == 0;
+            options.mode = std::strcmp(text, "checkerboard") == 0 ? checkerboard : sequential;
+        } else {
+            std::fprintf(stderr, "unknown option %s\n", name.c_str());
+            return false;
+        }
+        if (!ok) {
+            std::fprintf(stderr, "invalid value for %s: %s\n", name.c_str(), text);
+            return false;
+        }
+    }
+    uint64_t combinations = 1;
+    for (const sweep_axis_t &axis : options.sweeps) {
+        combinations *= axis.values.size();
+        if (combinations > MAXIMUM_SWEEP_COMBINATIONS) {
+            std::fprintf(stderr, "too many sweep combinations (at most %llu)\n", (unsigned long long)MAXIMUM_SWEEP_COMBINATIONS);
+            return false;
+        }
+    }
+    bool uses_state_files = !options.checkpoint.empty() || !options.snapshot.empty() || !options.restore.empty();
+    if (uses_state_files && (options.replicas > 0 || !options.sweeps.empty())) {
+        std::fprintf(stderr, "--checkpoint, --snapshot and --restore apply to a single simulation\n");
+        return false;
+    }
+    uint64_t total = (uint64_t)options.plants + options.herbivores + options.carnivores;
+    if (total > (uint64_t)options.width * options.height) {
+        std::fprintf(stderr, "too many entities for a %ux%u grid\n", options.width, options.height);
+        return false;
+    }
+    return true;
+}
+
+static void write_population(FILE *out, uint64_t tick, const population_t &population) {
+    std::fprintf(out, "%llu,%llu,%llu,%llu\n", (unsigned long long)tick, (unsigned long long)population.plants,
+                 (unsigned long long)population.herbivores, (unsigned long long)population.carnivores);
+}
+
+// Quantil q de valores ordenados, com interpolação linear entre as posições vizinhas
+static double quantile(const std::vector<double> &sorted, double q) {
+    double position = q * (sorted.size() - 1);
+    size_t below = (size_t)position;
+    size_t above = std::min(below + 1, sorted.size() - 1);
+    return sorted[below] + (position - below) * (sorted[above] - sorted[below]);
+}
+
+// Escreve as estatísticas de uma população entre as réplicas (values é reordenado)
+static void write_statistics(FILE *out, std::vector<double> &values) {
+    double mean = 0;
+    for (double value : values) {
+        mean += value;
+    }
+    mean /= values.size();
+    double variance = 0;
+    for (double value : values) {
+        variance += (value - mean) * (value - mean);
+    }
+    variance = values.size() > 1 ? variance / (values.size() - 1) : 0;
+    std::sort(values.begin(), values.end());
+    std::fprintf(out, ",%.6g,%.6g,%.6g,%.6g,%.6g", mean, variance, quantile(values, 0.05), quantile(values, 0.5), quantile(values, 0.95));
+}
+
+// Escreve a linha de uma iteração a partir das populações de todas as réplicas
+static void write_ensemble_row(FILE *out, uint64_t tick, const population_t *populations, size_t count, size_t stride) {
+    std::vector<double> plants(count), herbivores(count), carnivores(count);
+    for (size_t r = 0; r < count; r++) {
+        plants[r] = populations[r * stride].plants;
+        herbivores[r] = populations[r * stride].herbivores;
+        carnivores[r] = populations[r * stride].carnivores;
+    }
+    std::fprintf(out, "%llu", (unsigned long long)tick);
+    write_statistics(out, plants);
+    write_statistics(out, herbivores);
+    write_statistics(out, carnivores);
+    std::fprintf(out, "\n");
+}
+
+// Roda as réplicas no pool. Elas não compartilham nada, então cada tarefa avança uma
+// réplica inteira por um bloco de iterações na sua própria thread (sem usar o pool por
+// entidade); ao fim de cada bloco, as populações guardadas são agregadas e descartadas.
+static void run_ensemble(const batch_options_t &options, thread_pool_t &pool, FILE *out) {
+    size_t count = options.replicas;
+    // simulation_t contém um mutex e não pode ser movida, por isso os ponteiros
+    std::vector<std::unique_ptr<simulation_t>> replicas(count);
+    std::vector<std::future<void>> done(count);
+    for (size_t r = 0; r < count; r++) {
+        replicas[r] = std::make_unique<simulation_t>();
+        replicas[r]->record_history = false;
+        done[r] = pool.submit([&options, &replicas, r]() {
+            setup_simulation(*replicas[r], options.height, options.width, options.plants, options.herbivores, options.carnivores,
+                             options.seed + r, options.mode, options.rules);
+        });
+    }
+    for (std::future<void> &result : done) {
+        pool.wait(result);
+    }
+    // Populações de cada réplica no bloco atual: a réplica r na iteração k do bloco fica em r * ENSEMBLE_BLOCK_TICKS + k
+    std::vector<population_t> populations(count * ENSEMBLE_BLOCK_TICKS);
+    for (size_t r = 0; r < count; r++) {
+        populations[r * ENSEMBLE_BLOCK_TICKS] = count_population(replicas[r]->grid);
+    }
+    std::fprintf(out, "tick");
+    for (const char *name : {"plants", "herbivores", "carnivores"}) {
+        std::fprintf(out, ",%s_mean,%s_variance,%s_p05,%s_p50,%s_p95", name, name, name, name, name);
+    }
+    std::fprintf(out, "\n");
+    write_ensemble_row(out, 0, populations.data(), count, ENSEMBLE_BLOCK_TICKS);
+    for (uint64_t first = 1; first <= options.ticks; first += ENSEMBLE_BLOCK_TICKS) {
+        uint64_t block = std::min(ENSEMBLE_BLOCK_TICKS, options.ticks - first + 1);
+        for (size_t r = 0; r < count; r++) {
+            done[r] = pool.submit([&replicas, &populations, r, block]() {
+                for (uint64_t k = 0; k < block; k++) {
+                    advance_simulation(*replicas[r]);
+                    populations[r * ENSEMBLE_BLOCK_TICKS + k] = count_population(replicas[r]->grid);
+                }
+            });
+        }
+        for (std::future<void> &result : done) {
+            pool.wait(result);
+        }
+        for (uint64_t k = 0; k < block; k++) {
+            write_ensemble_row(out, first + k, populations.data() + k, count, ENSEMBLE_BLOCK_TICKS);
+        }
+    }
+}
+
+// Combinação de uma varredura em andamento: as populações finais de cada réplica
+struct sweep_combination_t {
+    rules_t rules;
+    std::vector<population_t> populations;
+    std::vector<std::future<void>> done;
+};
+
+// Escreve a fração dos valores iguais a zero
+static void write_extinction(FILE *out, const std::vector<double> &values) {
+    size_t extinct = std::count(values.begin(), values.end(), 0.0);
+    std::fprintf(out, ",%.6g", (double)extinct / values.size());
+}
+
+// Roda a varredura: cada réplica de cada combinação é uma tarefa do pool, que roda a
+// simulação inteira na sua própria thread. As combinações são enviadas ao pool em uma
+// janela que mantém todas as threads ocupadas, e as linhas saem na ordem das combinações
+// à medida que terminam, sem guardar os resultados da varredura inteira.
+static void run_sweep(const batch_options_t &options, thread_pool_t &pool, FILE *out) {
+    size_t replicas = std::max<uint32_t>(1, options.replicas);
+    size_t combinations = 1;
+    for (const sweep_axis_t &axis : options.sweeps) {
+        combinations *= axis.values.size();
+    }
+    for (const sweep_axis_t &axis : options.sweeps) {
+        std::fprintf(out, "%s,", axis.field->name);
+    }
+    std::fprintf(out, "replicas");
+    for (const char *name : {"plants", "herbivores", "carnivores"}) {
+        std::fprintf(out, ",%s_mean,%s_variance,%s_p05,%s_p50,%s_p95,%s_extinct", name, name, name, name, name, name);
+    }
+    std::fprintf(out, "\n");
+    size_t window = std::max<size_t>(2, 4 * (size_t)pool.size() / replicas + 1);
+    std::deque<sweep_combination_t> pending;
+    size_t next = 0;
+    while (next < combinations || !pending.empty()) {
+        while (next < combinations && pending.size() < window) {
+            // A última dimensão da varredura varia mais rápido
+            sweep_combination_t &combination = pending.emplace_back();
+            combination.rules = options.rules;
+            size_t position = next++;
+            for (size_t a = options.sweeps.size(); a-- > 0;) {
+                const sweep_axis_t &axis = options.sweeps[a];
+                set_rule(combination.rules, *axis.field, axis.values[position % axis.values.size()]);
+                position /= axis.values.size();
+            }
+            combination.populations.resize(replicas);
+            for (size_t r = 0; r < replicas; r++) {
+                combination.done.push_back(pool.submit([&options, &combination, r]() {
+                    simulation_t sim;
+                    sim.record_history = false;
+                    setup_simulation(sim, options.height, options.width, options.plants, options.herbivores, options.carnivores, options.seed + r,
+                                     options.mode, combination.rules);
+                    while (sim.tick < options.ticks) {
+                        advance_simulation(sim);
+                    }
+                    combination.populations[r] = count_population(sim.grid);
+                }));
+            }
+        }
+        sweep_combination_t &combination = pending.front();
+        for (std::future<void> &result : combination.done) {
+            pool.wait(result);
+        }
+        for (const sweep_axis_t &axis : options.sweeps) {
+            std::fprintf(out, "%.6g,", get_rule(combination.rules, *axis.field));
+        }
+        std::fprintf(out, "%zu", replicas);
+        std::vector<double> plants(replicas), herbivores(replicas), carnivores(replicas);
+        for (size_t r = 0; r < replicas; r++) {
+            plants[r] = combination.populations[r].plants;
+            herbivores[r] = combination.populations[r].herbivores;
+            carnivores[r] = combination.populations[r].carnivores;
+        }
+        for (std::vector<double> *values : {&plants, &herbivores, &carnivores}) {
+            write_statistics(out, *values);
+            write_extinction(out, *values);
+        }
+        std::fprintf(out, "\n");
+        pending.pop_front();
+    }
+}
+
+int main(int argc, char **argv) {
+    batch_options_t options;
+    if (!parse_options(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s --width W --height H --plants P --herbivores H --carnivores C --seed S --ticks T\n"
+                     "       [--mode sequential|checkerboard] [--output file.csv] [--threads N] [--replicas R]\n"
+                     "       [--rule name=value]... [--sweep name=start:end:step | name=v1,v2,...]...\n"
+                     "       [--checkpoint file] [--snapshot file] [--restore file]\n",
+                     argv[0]);
+        return 1;
+    }
+    FILE *out = stdout;
+    if (!options.output.empty() && (out = std::fopen(options.output.c_str(), "w")) == nullptr) {
+        std::perror(options.output.c_str());
+        return 1;
+    }
+    thread_pool_t pool(options.threads);
+    if (!options.sweeps.empty()) {
+        run_sweep(options, pool, out);
+    } else if (options.replicas > 0) {
+        run_ensemble(options, pool, out);
+    } else {
+        simulation_t sim;
+        sim.record_history = false;
+        std::string error;
+        if (options.restore.empty()) {
+            setup_simulation(sim, options.height, options.width, options.plants, options.herbivores, options.carnivores, options.seed, options.mode,
+                             options.rules);
+        } else if (is_snapshot_file(options.restore) ? !load_snapshot(options.restore, sim, true, UINT32_MAX, error)
+                                                     : !load_checkpoint(options.restore, sim, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        std::fprintf(out, "tick,plants,herbivores,carnivores\n");
+        write_population(out, sim.tick, count_population(sim.grid));
+        while (sim.tick < options.ticks) {
+            advance_simulation(sim, pool);
+            write_population(out, sim.tick, count_population(sim.grid));
+        }
+        if ((!options.checkpoint.empty() && !save_checkpoint(options.checkpoint, sim, error)) ||
+            (!options.snapshot.empty() && !save_snapshot(options.snapshot, sim, error))) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+    }
+    if (out != stdout && std::fclose(out) != 0) {
+        std::perror(options.output.c_str());
+        return 1;
+    }
+    return 0;
+}
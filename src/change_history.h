@@ -0,0 +1,88 @@
+/*
+    Histórico das células ocupadas nas últimas iterações, usado nas respostas
+    delta.
+
+    Uma célula vazia é sempre {empty, 0, 0}, então uma célula vazia na base e
+    na iteração atual não mudou, e toda célula que mudou estava ocupada em
+    uma das duas: basta guardar um mapa de bits das células ocupadas por
+    iteração, e o delta é a união do mapa da base com o da iteração atual,
+    com os valores atuais de cada célula. Uma entidade que só mudou de idade
+    ou de energia está ocupada nas duas e vai no delta, então o cliente que
+    o aplica chega ao grid atual (tests/delta_replay.cpp). O passo de
+    envelhecimento altera toda entidade viva a cada iteração, de modo que a
+    união também não é muito maior que as mudanças reais: as duas são
+    proporcionais à população, não ao tamanho do grid.
+*/
+
+#pragma once
+
+#include "grid.h"
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class change_history_t {
+public:
+    // Memória total dos mapas guardados; define quantas iterações cabem no histórico
+    static constexpr size_t MAXIMUM_BYTES = 64u << 20;
+    static constexpr size_t MAXIMUM_DEPTH = 64;
+    static constexpr size_t MINIMUM_DEPTH = 2;
+
+    // Esvazia o histórico para um grid de num_cells células
+    void reset(size_t num_cells) {
+        words = (num_cells + 63) / 64;
+        depth = std::clamp(MAXIMUM_BYTES / std::max<size_t>(1, words * sizeof(uint64_t)), MINIMUM_DEPTH, MAXIMUM_DEPTH);
+        frames.clear();
+    }
+
+    // Registra as células ocupadas do grid na iteração tick, descartando a mais antiga
+    // quando o histórico está cheio. As iterações devem ser registradas em sequência.
+    template <typename Grid>
+    void record(uint64_t tick, const Grid &grid) {
+        frame_t frame;
+        if (frames.size() == depth) {
+            frame = std::move(frames.front());
+            frames.pop_front();
+        }
+        frame.tick = tick;
+        frame.occupied.assign(words, 0);
+        size_t k = 0;
+        for (uint32_t i = 0; i < grid.rows; i++) {
+            for (uint32_t j = 0; j < grid.columns; j++, k++) {
+                frame.occupied[k >> 6] |= (uint64_t)(grid.type(i, j) != empty) << (k & 63);
+            }
+        }
+        frames.push_back(std::move(frame));
+    }
+
+    // Indica se a iteração tick ainda está no histórico
+    bool contains(uint64_t tick) const {
+        return !frames.empty() && tick >= frames.front().tick && tick <= frames.back().tick;
+    }
+
+    // Preenche out com os índices, em ordem crescente, das células que podem ter
+    // mudado entre base_tick e a última iteração registrada (base_tick deve estar no histórico)
+    void changed_since(uint64_t base_tick, std::vector<uint32_t> &out) const {
+        const std::vector<uint64_t> &base = frames[base_tick - frames.front().tick].occupied;
+        const std::vector<uint64_t> &latest = frames.back().occupied;
+        out.clear();
+        for (size_t w = 0; w < words; w++) {
+            uint64_t bits = base[w] | latest[w];
+            while (bits != 0) {
+                out.push_back((uint32_t)(w * 64 + __builtin_ctzll(bits)));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+private:
+    struct frame_t {
+        uint64_t tick = 0;
+        std::vector<uint64_t> occupied;
+    };
+
+    std::deque<frame_t> frames;
+    size_t words = 0;
+    size_t depth = MINIMUM_DEPTH;
+};
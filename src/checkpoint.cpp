@@ -0,0 +1,210 @@
+#include "checkpoint.h"
+#include "rules.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+static const uint64_t FNV_PRIME = 0x100000001B3ull;
+
+static void store_u32(unsigned char *cursor, uint32_t value) {
+    for (int k = 0; k < 4; k++) {
+        cursor[k] = (unsigned char)(value >> (8 * k));
+    }
+}
+
+static void store_u64(unsigned char *cursor, uint64_t value) {
+    store_u32(cursor, (uint32_t)value);
+    store_u32(cursor + 4, (uint32_t)(value >> 32));
+}
+
+static uint32_t load_u32(const unsigned char *cursor) {
+    return (uint32_t)cursor[0] | (uint32_t)cursor[1] << 8 | (uint32_t)cursor[2] << 16 | (uint32_t)cursor[3] << 24;
+}
+
+static uint64_t load_u64(const unsigned char *cursor) {
+    return load_u32(cursor) | (uint64_t)load_u32(cursor + 4) << 32;
+}
+
+// Uma multiplicação a cada 8 bytes, para que verificar um grid de centenas de megabytes custe milissegundos
+uint64_t checkpoint_checksum(const unsigned char *data, size_t size, uint64_t hash) {
+    size_t k = 0;
+    for (; k + 8 <= size; k += 8) {
+        hash = (hash ^ load_u64(data + k)) * FNV_PRIME;
+    }
+    for (; k < size; k++) {
+        hash = (hash ^ data[k]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+// Tamanho do checkpoint de um grid com num_cells células
+static size_t checkpoint_size(size_t num_cells) {
+    return CHECKPOINT_HEADER_SIZE + NUM_RULE_FIELDS * sizeof(uint64_t) + num_cells * CHECKPOINT_CELL_SIZE + sizeof(uint64_t);
+}
+
+bool valid_cell(uint32_t type, int32_t age, int32_t energy, const aging_rules_t &aging_rules) {
+    // Energia fora da faixa do layout packed não é alcançável com regras válidas
+    return type <= carnivore && age >= 0 && age <= aging_rules.maximum_age[type] && (type != empty || energy == 0) &&
+           energy >= packed_cell_t::MINIMUM_ENERGY && energy <= packed_cell_t::MAXIMUM_ENERGY;
+}
+
+void write_checkpoint(std::string &out, const simulation_t &sim) {
+    const grid_t &grid = sim.grid;
+    size_t start = out.size();
+    out.resize(start + checkpoint_size(grid.size()));
+    unsigned char *begin = reinterpret_cast<unsigned char *>(&out[start]);
+    unsigned char *cursor = begin;
+    std::memcpy(cursor, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    store_u32(cursor + 8, CHECKPOINT_VERSION);
+    store_u32(cursor + 12, (uint32_t)sim.mode);
+    store_u32(cursor + 16, grid.rows);
+    store_u32(cursor + 20, grid.columns);
+    store_u64(cursor + 24, sim.tick);
+    store_u64(cursor + 32, sim.seed);
+    store_u32(cursor + 40, (uint32_t)NUM_RULE_FIELDS);
+    cursor += CHECKPOINT_HEADER_SIZE;
+    for (size_t k = 0; k < NUM_RULE_FIELDS; k++, cursor += sizeof(uint64_t)) {
+        double value = get_rule(sim.rules, RULE_FIELDS[k]);
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        store_u64(cursor, bits);
+    }
+    for (uint32_t i = 0; i < grid.rows; i++) {
+        for (uint32_t j = 0; j < grid.columns; j++, cursor += CHECKPOINT_CELL_SIZE) {
+            entity_t entity = grid.get(i, j);
+            cursor[0] = (unsigned char)entity.type;
+            cursor[1] = (unsigned char)entity.age;
+            store_u32(cursor + 2, (uint32_t)entity.energy);
+        }
+    }
+    store_u64(cursor, checkpoint_checksum(begin, cursor - begin));
+}
+
+static bool has_checkpoint_header(const unsigned char *begin, size_t size) {
+    return size >= CHECKPOINT_HEADER_SIZE && std::memcmp(begin, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0;
+}
+
+bool checkpoint_dimensions(const char *data, size_t size, uint32_t &rows, uint32_t &columns) {
+    const unsigned char *begin = reinterpret_cast<const unsigned char *>(data);
+    if (!has_checkpoint_header(begin, size)) {
+        return false;
+    }
+    rows = load_u32(begin + 16);
+    columns = load_u32(begin + 20);
+    return true;
+}
+
+bool read_checkpoint(const char *data, size_t size, simulation_t &sim, std::string &error) {
+    const unsigned char *begin = reinterpret_cast<const unsigned char *>(data);
+    if (!has_checkpoint_header(begin, size)) {
+        error = "not a checkpoint";
+        return false;
+    }
+    if (load_u32(begin + 8) != CHECKPOINT_VERSION) {
+        error = "unsupported version " + std::to_string(load_u32(begin + 8));
+        return false;
+    }
+    uint32_t mode = load_u32(begin + 12);
+    uint32_t rows = load_u32(begin + 16);
+    uint32_t columns = load_u32(begin + 20);
+    if (mode > checkerboard || rows == 0 || columns == 0 || load_u32(begin + 40) != NUM_RULE_FIELDS) {
+        error = "invalid header";
+        return false;
+    }
+    if (size != checkpoint_size((size_t)rows * columns)) {
+        error = "truncated or oversized file";
+        return false;
+    }
+    size_t checksum_offset = size - sizeof(uint64_t);
+    if (load_u64(begin + checksum_offset) != checkpoint_checksum(begin, checksum_offset)) {
+        error = "checksum mismatch";
+        return false;
+    }
+    const unsigned char *cursor = begin + CHECKPOINT_HEADER_SIZE;
+    rules_t rules;
+    for (size_t k = 0; k < NUM_RULE_FIELDS; k++, cursor += sizeof(uint64_t)) {
+        uint64_t bits = load_u64(cursor);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        if (!rule_accepts(RULE_FIELDS[k], value)) {
+            error = std::string("invalid rule ") + RULE_FIELDS[k].name;
+            return false;
+        }
+        set_rule(rules, RULE_FIELDS[k], value);
+    }
+    // As células são decodificadas em um grid à parte, que só substitui o da simulação se todas forem válidas
+    aging_rules_t aging_rules = make_aging_rules(rules);
+    grid_t grid;
+    grid.assign(rows, columns, {empty, 0, 0});
+    for (uint32_t i = 0; i < rows; i++) {
+        for (uint32_t j = 0; j < columns; j++, cursor += CHECKPOINT_CELL_SIZE) {
+            uint32_t type = cursor[0];
+            int32_t age = cursor[1];
+            int32_t energy = (int32_t)load_u32(cursor + 2);
+            if (!valid_cell(type, age, energy, aging_rules)) {
+                error = "invalid cell at " + std::to_string(i) + "," + std::to_string(j);
+                return false;
+            }
+            grid.set(i, j, {(entity_type_t)type, energy, age});
+        }
+    }
+    sim.grid = std::move(grid);
+    sim.rules = rules;
+    sim.aging_rules = aging_rules;
+    sim.mode = (update_mode_t)mode;
+    sim.tick = load_u64(begin + 24);
+    sim.seed = load_u64(begin + 32);
+    sim.analyzed_cells.resize(sim.grid.size());
+    sim.history.reset(sim.grid.size());
+    if (sim.record_history) {
+        sim.history.record(sim.tick, sim.grid);
+    }
+    sim.last_tick_entity_lock = {};
+    return true;
+}
+
+bool save_checkpoint(const std::string &path, const simulation_t &sim, std::string &error) {
+    std::string data;
+    write_checkpoint(data, sim);
+    std::string temporary = path + ".tmp";
+    FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        error = temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    bool written = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = path + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_checkpoint(const std::string &path, simulation_t &sim, std::string &error) {
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        error = path + ": " + std::strerror(errno);
+        return false;
+    }
+    std::string data;
+    bool read = std::fseek(file, 0, SEEK_END) == 0;
+    long size = read ? std::ftell(file) : -1;
+    if (size >= 0 && std::fseek(file, 0, SEEK_SET) == 0) {
+        data.resize(size);
+        read = std::fread(&data[0], 1, data.size(), file) == data.size();
+    } else {
+        read = false;
+    }
+    std::fclose(file);
+    if (!read) {
+        error = path + ": read error";
+        return false;
+    }
+    if (!read_checkpoint(data.data(), data.size(), sim, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
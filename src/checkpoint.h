@@ -0,0 +1,67 @@
+/*
+    Checkpoint do estado de uma simulação em um arquivo binário, para retomar
+    a simulação exatamente de onde ela parou.
+
+    Os sorteios são uma função pura de (semente, iteração, célula) (ver
+    rng.h), então o estado do gerador se resume à semente e à iteração: com
+    o grid, as regras e o modo, a simulação restaurada produz as mesmas
+    iterações que a original produziria. O histórico das respostas delta
+    não é guardado; ele recomeça na iteração restaurada.
+
+    O formato não depende da representação do grid, e tudo é little-endian:
+         0  magic "ECOSCKPT"      8  versão (u32)       12  modo (u32)
+        16  linhas (u32)         20  colunas (u32)      24  iteração (u64)
+        32  semente (u64)        40  número de parâmetros das regras (u32)
+        44  parâmetros das regras (f64 cada, na ordem de RULE_FIELDS)
+        ..  células, linha a linha, 6 bytes cada: tipo (u8), idade (u8) e
+            energia (i32), em largura total, para que a restauração seja
+            exata em qualquer representação do grid
+        ..  checksum (u64) de todos os bytes anteriores
+    Uma mudança no formato ou em rules_t exige uma nova versão.
+
+    Além do checksum, a leitura rejeita células que a simulação não produz:
+    tipo desconhecido, idade acima da máxima do tipo, energia fora da faixa
+    que as regras permitem alcançar e célula vazia com energia ou idade.
+*/
+
+#pragma once
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+static const char CHECKPOINT_MAGIC[8] = {'E', 'C', 'O', 'S', 'C', 'K', 'P', 'T'};
+static const uint32_t CHECKPOINT_VERSION = 2;
+static const size_t CHECKPOINT_HEADER_SIZE = 44;
+static const size_t CHECKPOINT_CELL_SIZE = 6;
+
+// Checksum dos checkpoints e dos snapshots: FNV-1a aplicado a palavras de 64 bits
+// little-endian (e aos bytes finais um a um). Passar o resultado de um trecho em hash
+// continua o checksum no trecho seguinte.
+static const uint64_t CHECKSUM_OFFSET_BASIS = 0xCBF29CE484222325ull;
+uint64_t checkpoint_checksum(const unsigned char *data, size_t size, uint64_t hash = CHECKSUM_OFFSET_BASIS);
+
+// Indica se a célula pode ser alcançada com as regras: tipo conhecido, idade até o máximo
+// do tipo, energia na faixa do layout packed e célula vazia sem energia nem idade. Vale
+// para as células lidas de checkpoints e de snapshots.
+bool valid_cell(uint32_t type, int32_t age, int32_t energy, const aging_rules_t &aging_rules);
+
+// Acrescenta ao fim de out o checkpoint da simulação
+void write_checkpoint(std::string &out, const simulation_t &sim);
+
+// Lê as dimensões do grid no cabeçalho de um checkpoint, sem decodificar as células, para
+// que quem restaura possa recusar um grid grande demais antes de alocá-lo. Retorna false
+// se os dados não começarem com o cabeçalho de um checkpoint.
+bool checkpoint_dimensions(const char *data, size_t size, uint32_t &rows, uint32_t &columns);
+
+// Restaura a simulação a partir dos size bytes de um checkpoint. Se ele for
+// inválido, retorna false com o motivo em error, sem alterar a simulação.
+bool read_checkpoint(const char *data, size_t size, simulation_t &sim, std::string &error);
+
+// Grava o checkpoint em path, por meio de um arquivo temporário renomeado no fim,
+// de modo que um checkpoint anterior no mesmo caminho nunca fica pela metade
+bool save_checkpoint(const std::string &path, const simulation_t &sim, std::string &error);
+
+// Lê e restaura o checkpoint gravado em path
+bool load_checkpoint(const std::string &path, simulation_t &sim, std::string &error);
@@ -12037,6 +12037,10 @@ namespace crow
               [this, p, &is, service_idx](boost::system::error_code ec) {
                   if (!ec)
                   {
+                      // ecosim: respostas com mais de 16 buffers (cabeçalhos extras) saem em
+                      // duas escritas; sem TCP_NODELAY, a segunda espera o ACK atrasado do cliente
+                      boost::system::error_code option_ec;
+                      p->socket().set_option(tcp::no_delay(true), option_ec);
                       is.post(
                         [p] {
                             p->start();
@@ -0,0 +1,352 @@
+/*
+    Grid de entidades da simulação.
+
+    As células ficam em um único buffer contíguo, em ordem de linhas
+    (row-major): a célula (i, j) fica na posição i * columns + j.
+
+    Há três representações de célula, escolhidas em tempo de compilação
+    (ECOSIM_GRID_LAYOUT no CMake):
+    - aos_grid_t (padrão): um entity_t por célula (12 bytes);
+    - packed_grid_t: a célula é compactada em 4 bytes;
+    - soa_grid_t: tipo, energia e idade em planos separados (6 bytes), de
+      modo que percorrer os vizinhos só traz o plano de tipos para o cache.
+    Todas expõem a mesma interface (type/get/set), e o restante do código só
+    enxerga entity_t, que é a representação usada na fronteira do JSON.
+
+    Os planos de células são cell_buffer_t: um vetor próprio ou, quando a
+    simulação vem de um snapshot (ver snapshot.h), uma região mapeada do
+    arquivo, copiada página a página pelo sistema só quando é escrita.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+enum entity_type_t {
+    empty,
+    plant,
+    herbivore,
+    carnivore
+};
+
+struct entity_t {
+    entity_type_t type;
+    int32_t energy;
+    int32_t age;
+};
+
+// Células de um plano do grid, em um vetor próprio ou em memória externa (a região
+// mapeada de um snapshot). Uma cópia sempre tem um vetor próprio.
+template <typename T>
+class cell_buffer_t {
+public:
+    cell_buffer_t() = default;
+
+    cell_buffer_t(const cell_buffer_t &other) : owned(other.begin(), other.end()), cells(owned.data()), count(owned.size()) {
+    }
+
+    cell_buffer_t(cell_buffer_t &&other) noexcept {
+        *this = std::move(other);
+    }
+
+    cell_buffer_t &operator=(const cell_buffer_t &other) {
+        if (this != &other) {
+            owned.assign(other.begin(), other.end());
+            use_owned();
+        }
+        return *this;
+    }
+
+    cell_buffer_t &operator=(cell_buffer_t &&other) noexcept {
+        if (this != &other) {
+            owned = std::move(other.owned);
+            external = std::move(other.external);
+            cells = other.cells;
+            count = other.count;
+            other.owned.clear();
+            other.use_owned();
+        }
+        return *this;
+    }
+
+    // Preenche um vetor próprio com num_cells cópias de value
+    void assign(size_t num_cells, const T &value) {
+        owned.assign(num_cells, value);
+        use_owned();
+    }
+
+    // Passa a usar num_cells células em data, que continuam válidas enquanto
+    // alguma cópia de keeper existir
+    void attach(T *data, size_t num_cells, std::shared_ptr<void> keeper) {
+        std::vector<T>().swap(owned);
+        external = std::move(keeper);
+        cells = data;
+        count = num_cells;
+    }
+
+    // Indica se as células estão em memória externa
+    bool attached() const {
+        return external != nullptr;
+    }
+
+    T &operator[](size_t k) {
+        return cells[k];
+    }
+
+    const T &operator[](size_t k) const {
+        return cells[k];
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    T *data() {
+        return cells;
+    }
+
+    const T *data() const {
+        return cells;
+    }
+
+    T *begin() {
+        return cells;
+    }
+
+    T *end() {
+        return cells + count;
+    }
+
+    const T *begin() const {
+        return cells;
+    }
+
+    const T *end() const {
+        return cells + count;
+    }
+
+private:
+    void use_owned() {
+        external.reset();
+        cells = owned.data();
+        count = owned.size();
+    }
+
+    std::vector<T> owned;
+    std::shared_ptr<void> external;
+    T *cells = nullptr;
+    size_t count = 0;
+};
+
+// Dimensões e endereçamento comuns a todas as representações
+struct grid_shape_t {
+    uint32_t rows = 0;
+    uint32_t columns = 0;
+
+    size_t size() const {
+        return (size_t)rows * columns;
+    }
+
+    // Posição da célula (i, j) no buffer
+    size_t index(uint32_t i, uint32_t j) const {
+        return (size_t)i * columns + j;
+    }
+};
+
+// Um entity_t por célula
+struct aos_grid_t : grid_shape_t {
+    cell_buffer_t<entity_t> cells;
+
+    // Redimensiona o grid e preenche todas as células com value
+    void assign(uint32_t num_rows, uint32_t num_columns, const entity_t &value) {
+        rows = num_rows;
+        columns = num_columns;
+        cells.assign(size(), value);
+    }
+
+    entity_type_t type(uint32_t i, uint32_t j) const {
+        return cells[index(i, j)].type;
+    }
+
+    entity_t get(uint32_t i, uint32_t j) const {
+        return cells[index(i, j)];
+    }
+
+    void set(uint32_t i, uint32_t j, const entity_t &entity) {
+        cells[index(i, j)] = entity;
+    }
+
+    size_t cell_bytes() const {
+        return sizeof(entity_t);
+    }
+
+    // Aplica visit a cada plano de células (aqui, um só)
+    template <typename Visit>
+    void for_each_plane(Visit visit) {
+        visit(cells);
+    }
+
+    template <typename Visit>
+    void for_each_plane(Visit visit) const {
+        visit(cells);
+    }
+};
+
+// Célula compactada em 32 bits: tipo nos bits 0-1, idade nos bits 2-8
+// (até 127) e energia com sinal nos bits 9-31 (de -4194304 a 4194303).
+// As faixas das regras (rules.cpp) garantem que nenhuma entidade passe disso.
+struct packed_cell_t {
+    static const uint32_t TYPE_BITS = 2;
+    static const uint32_t AGE_BITS = 7;
+    static const uint32_t ENERGY_SHIFT = TYPE_BITS + AGE_BITS;
+    static const uint32_t TYPE_MASK = (1u << TYPE_BITS) - 1;
+    static const uint32_t AGE_MASK = (1u << AGE_BITS) - 1;
+    static const int32_t MAXIMUM_ENERGY = (1 << (31 - ENERGY_SHIFT)) - 1;
+    static const int32_t MINIMUM_ENERGY = -MAXIMUM_ENERGY - 1;
+
+    uint32_t bits;
+
+    static packed_cell_t pack(const entity_t &entity) {
+        return {(uint32_t)entity.type | (((uint32_t)entity.age & AGE_MASK) << TYPE_BITS) | ((uint32_t)entity.energy << ENERGY_SHIFT)};
+    }
+
+    entity_type_t type() const {
+        return (entity_type_t)(bits & TYPE_MASK);
+    }
+
+    int32_t age() const {
+        return (int32_t)((bits >> TYPE_BITS) & AGE_MASK);
+    }
+
+    int32_t energy() const {
+        // Deslocamento aritmético recupera o sinal da energia
+        return (int32_t)bits >> ENERGY_SHIFT;
+    }
+
+    entity_t unpack() const {
+        return {type(), energy(), age()};
+    }
+};
+
+static_assert(sizeof(packed_cell_t) == 4, "packed_cell_t must fit in 4 bytes");
+
+struct packed_grid_t : grid_shape_t {
+    cell_buffer_t<packed_cell_t> cells;
+
+    void assign(uint32_t num_rows, uint32_t num_columns, const entity_t &value) {
+        rows = num_rows;
+        columns = num_columns;
+        cells.assign(size(), packed_cell_t::pack(value));
+    }
+
+    entity_type_t type(uint32_t i, uint32_t j) const {
+        return cells[index(i, j)].type();
+    }
+
+    entity_t get(uint32_t i, uint32_t j) const {
+        return cells[index(i, j)].unpack();
+    }
+
+    void set(uint32_t i, uint32_t j, const entity_t &entity) {
+        cells[index(i, j)] = packed_cell_t::pack(entity);
+    }
+
+    size_t cell_bytes() const {
+        return sizeof(packed_cell_t);
+    }
+
+    // Aplica visit a cada plano de células (aqui, um só)
+    template <typename Visit>
+    void for_each_plane(Visit visit) {
+        visit(cells);
+    }
+
+    template <typename Visit>
+    void for_each_plane(Visit visit) const {
+        visit(cells);
+    }
+};
+
+// Tipo, energia e idade em planos separados (structure of arrays)
+struct soa_grid_t : grid_shape_t {
+    cell_buffer_t<uint8_t> types;
+    cell_buffer_t<int32_t> energies;
+    // A maior idade aceita pelas regras é 127, então um byte por célula basta
+    cell_buffer_t<uint8_t> ages;
+
+    void assign(uint32_t num_rows, uint32_t num_columns, const entity_t &value) {
+        rows = num_rows;
+        columns = num_columns;
+        types.assign(size(), (uint8_t)value.type);
+        energies.assign(size(), value.energy);
+        ages.assign(size(), (uint8_t)value.age);
+    }
+
+    entity_type_t type(uint32_t i, uint32_t j) const {
+        return (entity_type_t)types[index(i, j)];
+    }
+
+    entity_t get(uint32_t i, uint32_t j) const {
+        size_t k = index(i, j);
+        return {(entity_type_t)types[k], energies[k], ages[k]};
+    }
+
+    void set(uint32_t i, uint32_t j, const entity_t &entity) {
+        size_t k = index(i, j);
+        types[k] = (uint8_t)entity.type;
+        energies[k] = entity.energy;
+        ages[k] = (uint8_t)entity.age;
+    }
+
+    size_t cell_bytes() const {
+        return sizeof(uint8_t) + sizeof(int32_t) + sizeof(uint8_t);
+    }
+
+    // Aplica visit a cada plano de células: tipos, energias e idades
+    template <typename Visit>
+    void for_each_plane(Visit visit) {
+        visit(types);
+        visit(energies);
+        visit(ages);
+    }
+
+    template <typename Visit>
+    void for_each_plane(Visit visit) const {
+        visit(types);
+        visit(energies);
+        visit(ages);
+    }
+};
+
+// Número de entidades de cada tipo no grid
+struct population_t {
+    uint64_t plants = 0;
+    uint64_t herbivores = 0;
+    uint64_t carnivores = 0;
+};
+
+template <typename Grid>
+population_t count_population(const Grid &grid) {
+    population_t population;
+    for (uint32_t i = 0; i < grid.rows; i++) {
+        for (uint32_t j = 0; j < grid.columns; j++) {
+            entity_type_t type = grid.type(i, j);
+            population.plants += (type == plant);
+            population.herbivores += (type == herbivore);
+            population.carnivores += (type == carnivore);
+        }
+    }
+    return population;
+}
+
+#if defined(ECOSIM_GRID_LAYOUT_PACKED)
+using grid_t = packed_grid_t;
+#elif defined(ECOSIM_GRID_LAYOUT_SOA)
+using grid_t = soa_grid_t;
+#else
+using grid_t = aos_grid_t;
+#endif
@@ -0,0 +1,174 @@
+/*
+    Mutex instrumentado: conta as aquisições e as disputadas (quando o lock
+    já estava com outra thread) e soma o tempo de espera e o tempo com o
+    lock, em um lock_stats_t compartilhado pelos mutexes de um mesmo papel.
+    A espera disputada é sempre medida; a posse pode ser cronometrada em só
+    uma a cada hold_sample_interval aquisições de cada thread e multiplicada
+    pelo intervalo (o entity_mtx é tomado uma vez por entidade, e duas
+    leituras do relógio custariam mais que a própria posse).
+
+    Envolve qualquer tipo com lock/try_lock/unlock (e lock_shared/
+    try_lock_shared/unlock_shared, para locks compartilhados), então um
+    substituto do entity_mtx pode ser medido pelos mesmos contadores. Com
+    as métricas desligadas, só a espera disputada é registrada no
+    rastreamento (ver trace.h).
+*/
+
+#pragma once
+
+#include "metrics.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Valores dos contadores de um lock em um momento
+struct lock_counts_t {
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;
+    uint64_t wait_ns = 0;
+    uint64_t hold_ns = 0;
+};
+
+class lock_stats_t {
+public:
+    // name identifica o lock nas métricas; wait_event é o nome da espera no rastreamento (literais).
+    // Uma aquisição a cada hold_sample_interval, por thread, tem a posse cronometrada.
+    lock_stats_t(const char *name, const char *wait_event, uint32_t hold_sample_interval = 1)
+        : name(name), wait_event(wait_event), hold_sample_interval(hold_sample_interval) {
+    }
+
+    void record_acquisition(bool contended, uint64_t wait_ns) {
+        acquisitions.fetch_add(1, std::memory_order_relaxed);
+        if (contended) {
+            contended_acquisitions.fetch_add(1, std::memory_order_relaxed);
+            total_wait_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+        }
+    }
+
+    void record_hold(uint64_t hold_ns) {
+        total_hold_ns.fetch_add(hold_ns, std::memory_order_relaxed);
+    }
+
+    lock_counts_t snapshot() const {
+        return {acquisitions.load(std::memory_order_relaxed), contended_acquisitions.load(std::memory_order_relaxed),
+                total_wait_ns.load(std::memory_order_relaxed), total_hold_ns.load(std::memory_order_relaxed)};
+    }
+
+    // Retorna os contadores e os zera
+    lock_counts_t take() {
+        return {acquisitions.exchange(0, std::memory_order_relaxed), contended_acquisitions.exchange(0, std::memory_order_relaxed),
+                total_wait_ns.exchange(0, std::memory_order_relaxed), total_hold_ns.exchange(0, std::memory_order_relaxed)};
+    }
+
+    void add(const lock_counts_t &counts) {
+        acquisitions.fetch_add(counts.acquisitions, std::memory_order_relaxed);
+        contended_acquisitions.fetch_add(counts.contended, std::memory_order_relaxed);
+        total_wait_ns.fetch_add(counts.wait_ns, std::memory_order_relaxed);
+        total_hold_ns.fetch_add(counts.hold_ns, std::memory_order_relaxed);
+    }
+
+    const char *const name;
+    const char *const wait_event;
+    const uint32_t hold_sample_interval;
+
+private:
+    std::atomic<uint64_t> acquisitions{0};
+    std::atomic<uint64_t> contended_acquisitions{0};
+    std::atomic<uint64_t> total_wait_ns{0};
+    std::atomic<uint64_t> total_hold_ns{0};
+};
+
+template <typename Mutex = std::mutex>
+class instrumented_mutex_t {
+public:
+    explicit instrumented_mutex_t(lock_stats_t &stats) : stats(stats) {
+    }
+
+    instrumented_mutex_t(const instrumented_mutex_t &) = delete;
+    instrumented_mutex_t &operator=(const instrumented_mutex_t &) = delete;
+
+    void lock() {
+        exclusive_since = acquire([this]() { return mtx.try_lock(); }, [this]() { mtx.lock(); });
+    }
+
+    bool try_lock() {
+        if (!mtx.try_lock()) {
+            return false;
+        }
+        exclusive_since = acquired(false, 0);
+        return true;
+    }
+
+    void unlock() {
+        release(exclusive_since);
+        mtx.unlock();
+    }
+
+    // Locks compartilhados: o início de cada posse fica na thread, que deve ter no
+    // máximo um lock compartilhado instrumentado por vez
+    void lock_shared() {
+        shared_since = acquire([this]() { return mtx.try_lock_shared(); }, [this]() { mtx.lock_shared(); });
+    }
+
+    bool try_lock_shared() {
+        if (!mtx.try_lock_shared()) {
+            return false;
+        }
+        shared_since = acquired(false, 0);
+        return true;
+    }
+
+    void unlock_shared() {
+        release(shared_since);
+        mtx.unlock_shared();
+    }
+
+private:
+    using time_point = std::chrono::steady_clock::time_point;
+
+    // Tenta sem bloquear; se o lock estiver ocupado, mede a espera. Retorna o início da posse.
+    template <typename TryLock, typename Lock>
+    time_point acquire(TryLock try_lock, Lock lock) {
+        if (try_lock()) {
+            return acquired(false, 0);
+        }
+        trace_scope_t wait(stats.wait_event, "lock");
+        bool measured = metrics_enabled.load(std::memory_order_relaxed);
+        time_point start = measured ? std::chrono::steady_clock::now() : time_point();
+        lock();
+        uint64_t wait_ns = measured ? std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count() : 0;
+        return acquired(true, wait_ns);
+    }
+
+    // Registra a aquisição e retorna o início da posse, ou zero se ela não for
+    // cronometrada (fora da amostra ou com as métricas desligadas)
+    time_point acquired(bool contended, uint64_t wait_ns) {
+        if (!metrics_enabled.load(std::memory_order_relaxed)) {
+            return time_point();
+        }
+        stats.record_acquisition(contended, wait_ns);
+        static thread_local uint32_t acquisitions = 0;
+        if (acquisitions++ % stats.hold_sample_interval != 0) {
+            return time_point();
+        }
+        return std::chrono::steady_clock::now();
+    }
+
+    void release(time_point since) {
+        if (since != time_point()) {
+            uint64_t hold_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count();
+            stats.record_hold(hold_ns * stats.hold_sample_interval);
+        }
+    }
+
+    Mutex mtx;
+    lock_stats_t &stats;
+    // Início da posse exclusiva, escrito e lido só por quem tem o lock
+    time_point exclusive_since;
+    static thread_local time_point shared_since;
+};
+
+template <typename Mutex>
+thread_local std::chrono::steady_clock::time_point instrumented_mutex_t<Mutex>::shared_since;
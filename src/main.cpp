@@ -11,282 +11,621 @@
 
 #include "crow_all.h"
 #include "json.hpp"
+#include "checkpoint.h"
+#include "grid.h"
+#include "instrumented_mutex.h"
+#include "metrics.h"
+#include "rules.h"
+#include "serializer.h"
+#include "simulation.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
 #include <random>
+#include <shared_mutex>
+#include <unordered_map>
 #include <thread>
 #include <mutex>
 
-std::mutex entity_mtx;
-
-static const uint32_t NUM_ROWS = 15;
-
-// Constantes
-const uint32_t PLANT_MAXIMUM_AGE = 10;
-const uint32_t HERBIVORE_MAXIMUM_AGE = 50;
-const uint32_t CARNIVORE_MAXIMUM_AGE = 80;
-const uint32_t MAXIMUM_ENERGY = 200;
-const uint32_t THRESHOLD_ENERGY_FOR_REPRODUCTION = 20;
-
-// Probabilidades
-const double PLANT_REPRODUCTION_PROBABILITY = 0.2;
-const double HERBIVORE_REPRODUCTION_PROBABILITY = 0.075;
-const double CARNIVORE_REPRODUCTION_PROBABILITY = 0.025;
-const double HERBIVORE_MOVE_PROBABILITY = 0.7;
-const double HERBIVORE_EAT_PROBABILITY = 0.9;
-const double CARNIVORE_MOVE_PROBABILITY = 0.5;
-const double CARNIVORE_EAT_PROBABILITY = 1.0;
-
-// Definição de tipos
-enum entity_type_t {
-    empty,
-    plant,
-    herbivore,
-    carnivore
+// Dimensões padrão do grid, caso não sejam informadas no início da simulação
+static const uint32_t DEFAULT_NUM_ROWS = 15;
+static const uint32_t DEFAULT_NUM_COLUMNS = 15;
+// Maior dimensão aceita para cada lado do grid
+static const uint32_t MAXIMUM_GRID_DIMENSION = 16384;
+// Maior número de iterações executadas em uma única chamada de /advance
+static const uint64_t MAXIMUM_ADVANCE_STEPS = 1000000;
+// Maior intervalo entre iterações pedido por um cliente WebSocket (0 pausa o relógio)
+static const uint32_t MAXIMUM_TICK_INTERVAL_MS = 3600000;
+static const uint32_t MINIMUM_TICK_INTERVAL_MS = 10;
+// Maior número de sessões abertas ao mesmo tempo
+static const size_t MAXIMUM_SESSIONS = 1024;
+// Sessões sem clientes no /ws e sem requisições por esse tempo são descartadas
+static const std::chrono::minutes SESSION_IDLE_TIMEOUT(10);
+
+// Código auxilar para converter o update_mode_t enum em uma string
+NLOHMANN_JSON_SERIALIZE_ENUM(update_mode_t, {
+                                                {sequential, "sequential"},
+                                                {checkerboard, "checkerboard"},
+                                            })
+
+// Fonte das sementes e dos ids de sessão; as rotas rodam em várias threads, então o acesso é serializado
+static std::random_device rd;
+static std::mutex rd_mtx;
+
+uint64_t random_u64() {
+    std::lock_guard<std::mutex> lock(rd_mtx);
+    return ((uint64_t)rd() << 32) | rd();
+}
+
+// Rotas com latência medida separadamente em /metrics; as demais (arquivos estáticos,
+// caminhos desconhecidos) são somadas em "other", para que os rótulos não cresçam sem limite
+static const char *const METRIC_ROUTES[] = {"/", "/start-simulation", "/next-iteration", "/advance", "/ws", "/metrics", "/trace", "/locks", "/checkpoint", "/restore", "/snapshot", "/fork", "other"};
+static const size_t NUM_METRIC_ROUTES = sizeof(METRIC_ROUTES) / sizeof(METRIC_ROUTES[0]);
+
+struct route_metrics_t {
+    histogram_t seconds{TICK_BUCKETS, NUM_TICK_BUCKETS};
+    // Respostas com código 400 ou maior
+    std::atomic<uint64_t> errors{0};
 };
 
-struct pos_t {
-    uint32_t i;
-    uint32_t j;
+static route_metrics_t route_metrics[NUM_METRIC_ROUTES];
+// Duração da montagem dos quadros de grid, por formato
+static histogram_t json_serialization_seconds(TICK_BUCKETS, NUM_TICK_BUCKETS);
+static histogram_t binary_serialization_seconds(TICK_BUCKETS, NUM_TICK_BUCKETS);
+
+size_t metric_route_index(const std::string &url) {
+    for (size_t k = 0; k + 1 < NUM_METRIC_ROUTES; k++) {
+        if (url == METRIC_ROUTES[k]) {
+            return k;
+        }
+    }
+    return NUM_METRIC_ROUTES - 1;
+}
+
+// Middleware do Crow que mede a latência de cada requisição, da chegada ao fim do handler,
+// e a registra no rastreamento
+struct request_metrics_t {
+    struct context {
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void before_handle(crow::request &, crow::response &, context &ctx) {
+        ctx.start = std::chrono::steady_clock::now();
+    }
+
+    void after_handle(crow::request &req, crow::response &res, context &ctx) {
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        size_t index = metric_route_index(req.url);
+        if (tracing_enabled.load(std::memory_order_relaxed)) {
+            trace_event(METRIC_ROUTES[index], "http", ctx.start, end, "status", res.code);
+        }
+        if (!metrics_enabled.load(std::memory_order_relaxed)) {
+            return;
+        }
+        route_metrics_t &route = route_metrics[index];
+        route.seconds.observe(end - ctx.start);
+        if (res.code >= 400) {
+            route.errors.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
 };
 
-struct entity_t {
-    entity_type_t type;
-    int32_t energy;
-    int32_t age;
+// Converte um número decimal sem sinal: só dígitos, sem espaços, sinal ou sufixo, e sem estourar 64 bits
+bool parse_unsigned(const std::string &text, uint64_t &value) {
+    if (text.empty()) {
+        return false;
+    }
+    uint64_t result = 0;
+    for (char digit : text) {
+        if (digit < '0' || digit > '9' || result > (UINT64_MAX - (digit - '0')) / 10) {
+            return false;
+        }
+        result = result * 10 + (digit - '0');
+    }
+    value = result;
+    return true;
+}
+
+// Lê o parâmetro base (iteração que o cliente já tem); retorna false se ele for inválido
+bool parse_base_tick(const crow::request &req, uint64_t &base) {
+    if (req.url_params.get("base") == nullptr) {
+        return true;
+    }
+    return parse_unsigned(req.url_params.get("base"), base);
+}
+
+// Escreve o grid na resposta no formato pedido pelo cliente: binário quando o
+// cabeçalho Accept inclui application/octet-stream, JSON caso contrário.
+// Com o parâmetro base, a resposta traz só as células que mudaram desde essa
+// iteração; se ela já saiu do histórico, o grid completo é enviado.
+void write_grid_response(const crow::request &req, crow::response &res, const simulation_t &sim) {
+    trace_scope_t scope("serialize", "http", "tick", sim.tick);
+    bool binary = req.get_header_value("Accept").find("application/octet-stream") != std::string::npos;
+    uint64_t base = 0;
+    // A base já foi validada pela rota
+    bool has_base = req.url_params.get("base") != nullptr && parse_base_tick(req, base);
+    bool delta = has_base && sim.history.contains(base);
+    if (binary) {
+        res.set_header("Content-Type", "application/octet-stream");
+    }
+    bool measured = metrics_enabled.load(std::memory_order_relaxed);
+    std::chrono::steady_clock::time_point start;
+    if (measured) {
+        start = std::chrono::steady_clock::now();
+    }
+    std::vector<uint32_t> changes;
+    if (delta) {
+        sim.history.changed_since(base, changes);
+        // Em binário, um delta com mudanças demais seria maior que o quadro completo
+        delta = !binary || binary_delta_smaller(sim.grid, changes.size());
+    }
+    if (delta) {
+        if (binary) {
+            write_delta_binary(res.body, sim.grid, changes, base, sim.tick);
+        } else {
+            write_delta_json(res.body, sim.grid, changes, base, sim.tick);
+        }
+    } else if (binary) {
+        write_grid_binary(res.body, sim.grid, sim.tick);
+    } else if (has_base) {
+        // Base fora do histórico: grid completo, sem o campo "base" que marca um delta
+        res.body = "{\"grid\":";
+        write_grid_json(res.body, sim.grid);
+        res.body += ",\"tick\":" + std::to_string(sim.tick) + "}";
+    } else {
+        write_grid_json(res.body, sim.grid);
+    }
+    if (measured) {
+        (binary ? binary_serialization_seconds : json_serialization_seconds).observe(std::chrono::steady_clock::now() - start);
+    }
+}
+
+// Cliente conectado ao /ws e a última iteração enviada a ele. A conexão é apagada
+// pelo Crow logo depois do onclose, então os envios feitos fora da thread dela
+// conferem open, que o unsubscribe_viewer desliga, antes de usá-la.
+struct viewer_t {
+    crow::websocket::connection *connection;
+    std::shared_ptr<std::atomic<bool>> open;
+    uint64_t tick;
+    bool has_frame;
 };
 
-// Código auxilar para converter o entity_type_t enum em uma string
-NLOHMANN_JSON_SERIALIZE_ENUM(entity_type_t, {
-                                                {empty, " "},
-                                                {plant, "P"},
-                                                {herbivore, "H"},
-                                                {carnivore, "C"},
-                                            })
+// Envia o quadro ao cliente pela thread de io da conexão, onde o onclose e a
+// destruição dela também rodam: se o cliente saiu antes, o quadro é descartado.
+// Quem chama deve ter o mtx da sessão, que mantém a conexão viva até o post.
+void send_frame(const viewer_t &viewer, const std::string &frame) {
+    // O servidor não usa SSL, então toda conexão do /ws é sobre um SocketAdaptor
+    auto *connection = static_cast<crow::websocket::Connection<crow::SocketAdaptor> *>(viewer.connection);
+    std::shared_ptr<std::atomic<bool>> open = viewer.open;
+    connection->post([connection, open, frame]() {
+        if (open->load()) {
+            connection->send_binary(frame);
+        }
+    });
+}
+
+// Contadores dos locks de todas as sessões e do registro de sessões
+static lock_stats_t session_lock_stats("session", "session lock wait");
+static lock_stats_t registry_lock_stats("registry", "registry lock wait");
+using session_mutex_t = instrumented_mutex_t<std::mutex>;
+using registry_mutex_t = instrumented_mutex_t<std::shared_mutex>;
 
-// Código auxiliar para converter o entity_t struct em um objeto JSON
-namespace nlohmann {
-    void to_json(nlohmann::json &j, const entity_t &e) {
-        j = nlohmann::json{{"type", e.type}, {"energy", e.energy}, {"age", e.age}};
+// Sessão criada por /start-simulation: uma simulação independente, identificada
+// pelo id devolvido no cabeçalho X-Ecosim-Session
+struct session_t {
+    std::string id;
+    // Protege a simulação, os clientes do /ws e last_used
+    session_mutex_t mtx{session_lock_stats};
+    simulation_t sim;
+    std::vector<viewer_t> viewers;
+    std::chrono::steady_clock::time_point last_used;
+    // Relógio do /ws, protegidos pelo ticker_mtx
+    uint32_t tick_interval_ms = 0;
+    std::chrono::steady_clock::time_point next_tick;
+};
+
+// Sessões abertas, por id. A busca, feita em toda requisição, só precisa de leitura;
+// a escrita fica para a criação e a remoção de sessões.
+static registry_mutex_t sessions_mtx(registry_lock_stats);
+static std::unordered_map<std::string, std::shared_ptr<session_t>> sessions;
+
+// Id aleatório de 16 dígitos hexadecimais
+std::string new_session_id() {
+    char id[17];
+    snprintf(id, sizeof(id), "%016llx", (unsigned long long)random_u64());
+    return id;
+}
+
+// Procura a sessão indicada pelo parâmetro session; se ela não existir, preenche
+// a resposta de erro e retorna nullptr
+std::shared_ptr<session_t> find_session(const crow::request &req, crow::response &res) {
+    const char *id = req.url_params.get("session");
+    if (id == nullptr) {
+        res.code = 400;
+        res.body = "Missing session";
+        return nullptr;
+    }
+    std::shared_lock<registry_mutex_t> lock(sessions_mtx);
+    auto found = sessions.find(id);
+    if (found == sessions.end()) {
+        res.code = 404;
+        res.body = "Unknown session";
+        return nullptr;
     }
+    return found->second;
 }
 
-// Grid (matriz) que contém as enidades
-static std::vector<std::vector<entity_t>> entity_grid;
-// Matriz que contém as posições que já foram analizadas
-std::vector<std::pair<int, int>> analyzed_pos;
-// Matriz que contém as posições disponíveis
-std::vector<std::pair<int, int>> available_pos;
+// Remove as sessões sem clientes no /ws e sem uso há SESSION_IDLE_TIMEOUT.
+// Quem chama deve ter o sessions_mtx para escrita; sessões ocupadas ficam para a próxima vez.
+void expire_sessions() {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    for (auto it = sessions.begin(); it != sessions.end();) {
+        std::unique_lock<session_mutex_t> lock(it->second->mtx, std::try_to_lock);
+        bool idle = lock.owns_lock() && it->second->viewers.empty() && now - it->second->last_used > SESSION_IDLE_TIMEOUT;
+        if (lock.owns_lock()) {
+            lock.unlock();
+        }
+        if (idle) {
+            it = sessions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
 
-// Função para gerar um valor randômico com base na probabilidade
-static std::random_device rd;
-static std::mt19937 generator(rd());
-bool random_action(float probability) {
-    std::uniform_real_distribution<> distribution(0.0, 1.0);
-    return distribution(generator) < probability;
+// Registra uma sessão nova com um id sorteado; retorna false se o limite de sessões foi atingido
+bool register_session(const std::shared_ptr<session_t> &session) {
+    std::unique_lock<registry_mutex_t> lock(sessions_mtx);
+    expire_sessions();
+    if (sessions.size() >= MAXIMUM_SESSIONS) {
+        return false;
+    }
+    do {
+        session->id = new_session_id();
+    } while (sessions.count(session->id) > 0);
+    sessions[session->id] = session;
+    return true;
 }
 
-// Thread da planta
-void plant_thread(int i, int j) {
-    entity_mtx.lock();
-    // Caso tenha atingido 10 anos, a planta morre
-    if (entity_grid[i][j].age == 10) {
-        entity_grid[i][j] = {empty, 0, 0};
-    } else {
-        // Caso a planta não tenha morrido, incrementa a idade
-        entity_grid[i][j].age++;
-        // Lógica de reprodução da planta
-        if (random_action(PLANT_REPRODUCTION_PROBABILITY)) {
-            // Verifica as casas adjacentes e armazena no vetor available_pos
-            if ((i + 1) < NUM_ROWS && entity_grid[i + 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i + 1, j));
-            }
-            if (i > 0 && entity_grid[i - 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i - 1, j));
-            }
-            if ((j + 1) < NUM_ROWS && entity_grid[i][j + 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j + 1));
-            }
-            if (j > 0 && entity_grid[i][j - 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j - 1));
+// Envia a cada cliente da sessão no /ws o estado atual: um delta contra o último
+// quadro que ele recebeu, ou o grid completo se esse quadro saiu do histórico ou
+// se o delta seria maior. Quem chama deve ter o mtx da sessão.
+void broadcast_frames(session_t &session) {
+    const simulation_t &sim = session.sim;
+    trace_scope_t scope("broadcast", "ws", "viewers", session.viewers.size());
+    // Os clientes costumam estar na mesma iteração, então cada quadro é montado uma vez só
+    std::string full_frame;
+    std::map<uint64_t, std::string> delta_frames;
+    std::vector<uint32_t> changes;
+    for (viewer_t &viewer : session.viewers) {
+        if (viewer.has_frame && viewer.tick == sim.tick) {
+            continue;
+        }
+        const std::string *delta_frame = nullptr;
+        if (viewer.has_frame && sim.history.contains(viewer.tick)) {
+            auto found = delta_frames.find(viewer.tick);
+            if (found == delta_frames.end()) {
+                // Um quadro vazio no mapa marca a base cujo delta seria maior que o quadro completo
+                std::string &frame = delta_frames[viewer.tick];
+                sim.history.changed_since(viewer.tick, changes);
+                if (binary_delta_smaller(sim.grid, changes.size())) {
+                    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                    write_delta_binary(frame, sim.grid, changes, viewer.tick, sim.tick);
+                    if (metrics_enabled.load(std::memory_order_relaxed)) {
+                        binary_serialization_seconds.observe(std::chrono::steady_clock::now() - start);
+                    }
+                }
+                delta_frame = &frame;
+            } else {
+                delta_frame = &found->second;
             }
-            if (!available_pos.empty()) {
-                std::uniform_int_distribution<> distribution(0, available_pos.size() - 1);
-                int drawing = distribution(generator);
-                int line = available_pos[drawing].first;
-                int column = available_pos[drawing].second;
-                entity_grid[line][column].type = plant;
-                analyzed_pos.push_back(std::make_pair(line, column));
-                available_pos.clear();
+        }
+        if (delta_frame != nullptr && !delta_frame->empty()) {
+            send_frame(viewer, *delta_frame);
+        } else {
+            if (full_frame.empty()) {
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                write_grid_binary(full_frame, sim.grid, sim.tick);
+                if (metrics_enabled.load(std::memory_order_relaxed)) {
+                    binary_serialization_seconds.observe(std::chrono::steady_clock::now() - start);
+                }
             }
+            send_frame(viewer, full_frame);
         }
+        viewer.tick = sim.tick;
+        viewer.has_frame = true;
     }
-    entity_mtx.unlock();
 }
-// Thread do herbívoro
-void herbivore_thread(int i, int j) {
-    entity_mtx.lock();
-    // Caso tenha atingido 50 anos, ou a energia tenha acabado, o herbívoro morre
-    if (entity_grid[i][j].age == 50 || entity_grid[i][j].energy <= 0) {
-        entity_grid[i][j] = {empty, 0, 0};
-    } else {
-        // Caso o herbívoro não tenha morrido, incrementa a idade
-        entity_grid[i][j].age++;
-        // Lógica de alimentação do herbívoro
-        if ((i + 1) < NUM_ROWS && entity_grid[i + 1][j].type == plant && random_action(HERBIVORE_EAT_PROBABILITY)) {
-            entity_grid[i + 1][j] = {empty, 0, 0};
-            entity_grid[i][j].energy += 30;
-        }
-        if (i > 0 && entity_grid[i - 1][j].type == plant && random_action(HERBIVORE_EAT_PROBABILITY)) {
-            entity_grid[i - 1][j] = {empty, 0, 0};
-            entity_grid[i][j].energy += 30;
-        }
-        if ((j + 1) < NUM_ROWS && entity_grid[i][j + 1].type == plant && random_action(HERBIVORE_EAT_PROBABILITY)) {
-            entity_grid[i][j + 1] = {empty, 0, 0};
-            entity_grid[i][j].energy += 30;
-        }
-        if (j > 0 && entity_grid[i][j - 1].type == plant && random_action(HERBIVORE_EAT_PROBABILITY)) {
-            entity_grid[i][j - 1] = {empty, 0, 0};
-            entity_grid[i][j].energy += 30;
-        }
-        // Lógica de reprodução do herbívoro
-        if (random_action(HERBIVORE_REPRODUCTION_PROBABILITY) && entity_grid[i][j].energy >= 20) {
-            // Verifica as casas adjacentes e armazena no vetor available_pos
-            if ((i + 1) < NUM_ROWS && entity_grid[i + 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i + 1, j));
-            }
-            if (i > 0 && entity_grid[i - 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i - 1, j));
-            }
-            if ((j + 1) < NUM_ROWS && entity_grid[i][j + 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j + 1));
-            }
-            if (j > 0 && entity_grid[i][j - 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j - 1));
-            }
-            if (!available_pos.empty()) {
-                std::uniform_int_distribution<> distribution(0, available_pos.size() - 1);
-                int drawing = distribution(generator);
-                int line = available_pos[drawing].first;
-                int column = available_pos[drawing].second;
-                entity_grid[line][column].type = herbivore;
-                entity_grid[line][column].energy = 100;
-                entity_grid[i][j].energy = entity_grid[i][j].energy - 10;
-                analyzed_pos.push_back(std::make_pair(line, column));
-                available_pos.clear();
-            }
+
+// Relógio do servidor: avança cada sessão no intervalo pedido pelos seus clientes do /ws
+static std::mutex ticker_mtx;
+static std::condition_variable ticker_cv;
+// Sessões com intervalo diferente de 0
+static std::vector<std::shared_ptr<session_t>> ticking_sessions;
+static bool ticker_stopping = false;
+
+void set_tick_interval(const std::shared_ptr<session_t> &session, uint32_t interval_ms) {
+    {
+        std::lock_guard<std::mutex> lock(ticker_mtx);
+        session->tick_interval_ms = interval_ms;
+        session->next_tick = std::chrono::steady_clock::now() + std::chrono::milliseconds(interval_ms);
+        auto found = std::find(ticking_sessions.begin(), ticking_sessions.end(), session);
+        if (interval_ms == 0 && found != ticking_sessions.end()) {
+            ticking_sessions.erase(found);
+        } else if (interval_ms != 0 && found == ticking_sessions.end()) {
+            ticking_sessions.push_back(session);
         }
-        // Lógica de movimentação do herbívoro
-        if (random_action(HERBIVORE_MOVE_PROBABILITY)) {
-            // Verifica as casas adjacentes e armazena no vetor available_pos
-            if ((i + 1) < NUM_ROWS && entity_grid[i + 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i + 1, j));
-            }
-            if (i > 0 && entity_grid[i - 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i - 1, j));
-            }
-            if ((j + 1) < NUM_ROWS && entity_grid[i][j + 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j + 1));
-            }
-            if (j > 0 && entity_grid[i][j - 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j - 1));
-            }
-            if (!available_pos.empty()) {
-                std::uniform_int_distribution<> distribution(0, available_pos.size() - 1);
-                int drawing = distribution(generator);
-                int line = available_pos[drawing].first;
-                int column = available_pos[drawing].second;
-                entity_grid[line][column] = {herbivore, entity_grid[i][j].energy - 5, entity_grid[i][j].age};
-                entity_grid[i][j] = {empty, 0, 0};
-                analyzed_pos.push_back(std::make_pair(line, column));
-                available_pos.clear();
+    }
+    ticker_cv.notify_one();
+}
+
+void ticker_loop(thread_pool_t &pool) {
+    std::unique_lock<std::mutex> lock(ticker_mtx);
+    std::vector<std::shared_ptr<session_t>> due;
+    std::vector<std::future<void>> pending;
+    while (!ticker_stopping) {
+        if (ticking_sessions.empty()) {
+            ticker_cv.wait(lock);
+            continue;
+        }
+        std::chrono::steady_clock::time_point deadline = ticking_sessions[0]->next_tick;
+        for (const std::shared_ptr<session_t> &session : ticking_sessions) {
+            deadline = std::min(deadline, session->next_tick);
+        }
+        if (ticker_cv.wait_until(lock, deadline) != std::cv_status::timeout) {
+            continue;
+        }
+        // Iterações atrasadas não se acumulam: se a anterior passou do prazo, o relógio da sessão recomeça agora
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        due.clear();
+        for (const std::shared_ptr<session_t> &session : ticking_sessions) {
+            if (session->next_tick <= now) {
+                due.push_back(session);
+                session->next_tick = std::max(session->next_tick + std::chrono::milliseconds(session->tick_interval_ms), now);
             }
         }
+        lock.unlock();
+        // Sessões diferentes avançam em paralelo no pool
+        for (const std::shared_ptr<session_t> &session : due) {
+            // Só as threads do pool executam estas tarefas: dentro do pool.wait() de uma requisição
+            // que avança a sessão, a thread já teria o lock, e o try_lock nele seria indefinido
+            pending.push_back(pool.submit_to_workers([session, &pool]() {
+                // Se uma requisição está avançando a sessão, esta iteração do relógio é pulada
+                std::unique_lock<session_mutex_t> session_lock(session->mtx, std::try_to_lock);
+                if (!session_lock.owns_lock()) {
+                    return;
+                }
+                advance_simulation(session->sim, pool);
+                broadcast_frames(*session);
+            }));
+        }
+        for (std::future<void> &done : pending) {
+            done.wait();
+        }
+        pending.clear();
+        lock.lock();
     }
-    entity_mtx.unlock();
 }
-// Thread do carnívoro
-void carnivore_thread(int i, int j) {
-    entity_mtx.lock();
-    // Caso tenha atingido 80 anos, ou a energia tenha acabado, o carnívoro morre
-    if (entity_grid[i][j].age == 80 || entity_grid[i][j].energy <= 0) {
-        entity_grid[i][j] = {empty, 0, 0};
-    } else {
-        // Caso o carnívoro não tenha morrido, incrementa a idade
-        entity_grid[i][j].age++;
-        // Lógica de alimentação do carnívoro
-        if (i + 1 < NUM_ROWS && entity_grid[i + 1][j].type == herbivore && random_action(CARNIVORE_EAT_PROBABILITY)) {
-            entity_grid[i + 1][j] = {empty, 0, 0};
-            entity_grid[i][j].energy += 20;
-        }
-        if (i > 0 && entity_grid[i - 1][j].type == herbivore && random_action(CARNIVORE_EAT_PROBABILITY)) {
-            entity_grid[i - 1][j] = {empty, 0, 0};
-            entity_grid[i][j].energy += 20;
-        }
-        if (j + 1 < NUM_ROWS && entity_grid[i][j + 1].type == herbivore && random_action(CARNIVORE_EAT_PROBABILITY)) {
-            entity_grid[i][j + 1] = {empty, 0, 0};
-            entity_grid[i][j].energy += 20;
-        }
-        if (j > 0 && entity_grid[i][j - 1].type == herbivore && random_action(CARNIVORE_EAT_PROBABILITY)) {
-            entity_grid[i][j - 1] = {empty, 0, 0};
-            entity_grid[i][j].energy += 20;
-        }
-        // Lógica de reprodução do carnívoro
-        if (random_action(CARNIVORE_REPRODUCTION_PROBABILITY) && entity_grid[i][j].energy >= 20) {
-            // Verifica as casas adjacentes e armazena no vetor available_pos
-            if ((i + 1) < NUM_ROWS && entity_grid[i + 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i + 1, j));
-            }
-            if (i > 0 && entity_grid[i - 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i - 1, j));
-            }
-            if ((j + 1) < NUM_ROWS && entity_grid[i][j + 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j + 1));
-            }
-            if (j > 0 && entity_grid[i][j - 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j - 1));
-            }
-            if (!available_pos.empty()) {
-                std::uniform_int_distribution<> distribution(0, available_pos.size() - 1);
-                int drawing = distribution(generator);
-                int line = available_pos[drawing].first;
-                int column = available_pos[drawing].second;
-                entity_grid[line][column] = {carnivore, 100, 0};
-                entity_grid[i][j].energy = entity_grid[i][j].energy - 10;
-                analyzed_pos.push_back(std::make_pair(line, column));
-                available_pos.clear();
+
+// Retira o cliente do /ws da sessão a que está inscrito; o relógio da sessão
+// para quando o último cliente sai
+void unsubscribe_viewer(crow::websocket::connection &connection) {
+    std::shared_ptr<session_t> *subscription = static_cast<std::shared_ptr<session_t> *>(connection.userdata());
+    if (subscription == nullptr) {
+        return;
+    }
+    std::shared_ptr<session_t> session = *subscription;
+    delete subscription;
+    connection.userdata(nullptr);
+    bool last_viewer;
+    {
+        std::lock_guard<session_mutex_t> lock(session->mtx);
+        // Quadros ainda na fila da conexão não são mais enviados
+        for (viewer_t &viewer : session->viewers) {
+            if (viewer.connection == &connection) {
+                viewer.open->store(false);
             }
         }
-        // Lógica de movimentação do carnívoro
-        if (random_action(CARNIVORE_MOVE_PROBABILITY)) {
-            // Verifica as casas adjacentes e armazena no vetor available_pos
-            if ((i + 1) < NUM_ROWS && entity_grid[i + 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i + 1, j));
-            }
-            if (i > 0 && entity_grid[i - 1][j].type == empty) {
-                available_pos.push_back(std::make_pair(i - 1, j));
-            }
-            if ((j + 1) < NUM_ROWS && entity_grid[i][j + 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j + 1));
-            }
-            if (j > 0 && entity_grid[i][j - 1].type == empty) {
-                available_pos.push_back(std::make_pair(i, j - 1));
-            }
-            if (!available_pos.empty()) {
-                std::uniform_int_distribution<> distribution(0, available_pos.size() - 1);
-                int drawing = distribution(generator);
-                int line = available_pos[drawing].first;
-                int column = available_pos[drawing].second;
-                entity_grid[line][column] = {carnivore, entity_grid[i][j].energy - 5, entity_grid[i][j].age};
-                entity_grid[i][j] = {empty, 0, 0};
-                analyzed_pos.push_back(std::make_pair(line, column));
-                available_pos.clear();
-            }
+        session->viewers.erase(std::remove_if(session->viewers.begin(), session->viewers.end(),
+                                              [&connection](const viewer_t &viewer) { return viewer.connection == &connection; }),
+                               session->viewers.end());
+        session->last_used = std::chrono::steady_clock::now();
+        last_viewer = session->viewers.empty();
+    }
+    if (last_viewer) {
+        set_tick_interval(session, 0);
+    }
+}
+
+// Escreve as métricas do servidor: latência por rota, serialização, sessões e a
+// população somada de todas as sessões (contada no momento da coleta)
+void write_server_metrics(std::string &out) {
+    write_metric_header(out, "ecosim_http_request_duration_seconds", "histogram", "Time to handle an HTTP request, by route.");
+    for (size_t k = 0; k < NUM_METRIC_ROUTES; k++) {
+        route_metrics[k].seconds.write(out, "ecosim_http_request_duration_seconds", std::string("route=\"") + METRIC_ROUTES[k] + "\"");
+    }
+    write_metric_header(out, "ecosim_http_request_errors_total", "counter", "HTTP responses with status 400 or above, by route.");
+    for (size_t k = 0; k < NUM_METRIC_ROUTES; k++) {
+        write_sample(out, "ecosim_http_request_errors_total", std::string("route=\"") + METRIC_ROUTES[k] + "\"",
+                     route_metrics[k].errors.load(std::memory_order_relaxed));
+    }
+    write_metric_header(out, "ecosim_serialization_duration_seconds", "histogram", "Time to build a grid frame, by format.");
+    json_serialization_seconds.write(out, "ecosim_serialization_duration_seconds", "format=\"json\"");
+    binary_serialization_seconds.write(out, "ecosim_serialization_duration_seconds", "format=\"binary\"");
+    std::vector<std::shared_ptr<session_t>> open_sessions;
+    {
+        std::shared_lock<registry_mutex_t> lock(sessions_mtx);
+        for (const auto &entry : sessions) {
+            open_sessions.push_back(entry.second);
         }
     }
-    entity_mtx.unlock();
+    population_t total;
+    for (const std::shared_ptr<session_t> &session : open_sessions) {
+        std::lock_guard<session_mutex_t> lock(session->mtx);
+        population_t population = count_population(session->sim.grid);
+        total.plants += population.plants;
+        total.herbivores += population.herbivores;
+        total.carnivores += population.carnivores;
+    }
+    const lock_stats_t *locks[] = {&entity_lock_totals, &session_lock_stats, &registry_lock_stats};
+    lock_counts_t counts[3];
+    for (size_t k = 0; k < 3; k++) {
+        counts[k] = locks[k]->snapshot();
+    }
+    write_metric_header(out, "ecosim_lock_acquisitions_total", "counter", "Lock acquisitions, by lock.");
+    for (size_t k = 0; k < 3; k++) {
+        write_sample(out, "ecosim_lock_acquisitions_total", std::string("lock=\"") + locks[k]->name + "\"", counts[k].acquisitions);
+    }
+    write_metric_header(out, "ecosim_lock_contended_total", "counter", "Lock acquisitions that had to wait for another holder, by lock.");
+    for (size_t k = 0; k < 3; k++) {
+        write_sample(out, "ecosim_lock_contended_total", std::string("lock=\"") + locks[k]->name + "\"", counts[k].contended);
+    }
+    write_metric_header(out, "ecosim_lock_wait_seconds_total", "counter", "Time spent waiting for contended locks, by lock.");
+    for (size_t k = 0; k < 3; k++) {
+        write_sample(out, "ecosim_lock_wait_seconds_total", std::string("lock=\"") + locks[k]->name + "\"", counts[k].wait_ns / 1e9);
+    }
+    write_metric_header(out, "ecosim_lock_hold_seconds_total", "counter", "Time locks were held, by lock; sampled for entity_mtx.");
+    for (size_t k = 0; k < 3; k++) {
+        write_sample(out, "ecosim_lock_hold_seconds_total", std::string("lock=\"") + locks[k]->name + "\"", counts[k].hold_ns / 1e9);
+    }
+    write_metric_header(out, "ecosim_sessions", "gauge", "Open simulation sessions.");
+    write_sample(out, "ecosim_sessions", "", open_sessions.size());
+    write_metric_header(out, "ecosim_entities", "gauge", "Entities alive in all sessions, by type.");
+    write_sample(out, "ecosim_entities", "type=\"plant\"", total.plants);
+    write_sample(out, "ecosim_entities", "type=\"herbivore\"", total.herbivores);
+    write_sample(out, "ecosim_entities", "type=\"carnivore\"", total.carnivores);
 }
 
-int main() {
-    crow::SimpleApp app;
+// Extensão dos checkpoints das sessões no --checkpoint-dir; o nome do arquivo é o id da sessão
+static const char CHECKPOINT_EXTENSION[] = ".ckpt";
+
+// Extensão dos snapshots no --snapshot-dir
+static const char SNAPSHOT_EXTENSION[] = ".snap";
+static const size_t MAXIMUM_SNAPSHOT_NAME = 64;
+
+// Nomes de snapshot aceitos: letras, dígitos, '-' e '_', para que não saiam do diretório
+bool valid_snapshot_name(const char *name) {
+    size_t length = name == nullptr ? 0 : std::strlen(name);
+    if (length == 0 || length > MAXIMUM_SNAPSHOT_NAME) {
+        return false;
+    }
+    for (size_t k = 0; k < length; k++) {
+        if (!std::isalnum((unsigned char)name[k]) && name[k] != '-' && name[k] != '_') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Restaura as sessões gravadas em directory (criado se não existir), mantendo os ids,
+// para que os clientes continuem de onde pararam. Checkpoints inválidos são ignorados.
+bool restore_sessions(const std::string &directory) {
+    std::error_code error_code;
+    std::filesystem::create_directories(directory, error_code);
+    std::filesystem::directory_iterator entries(directory, error_code);
+    if (error_code) {
+        std::fprintf(stderr, "%s: %s\n", directory.c_str(), error_code.message().c_str());
+        return false;
+    }
+    for (const std::filesystem::directory_entry &entry : entries) {
+        if (entry.path().extension() != CHECKPOINT_EXTENSION || sessions.size() >= MAXIMUM_SESSIONS) {
+            continue;
+        }
+        std::shared_ptr<session_t> session = std::make_shared<session_t>();
+        std::string error;
+        if (!load_checkpoint(entry.path().string(), session->sim, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            continue;
+        }
+        session->id = entry.path().stem().string();
+        session->last_used = std::chrono::steady_clock::now();
+        sessions[session->id] = session;
+        std::fprintf(stderr, "restored session %s at tick %llu\n", session->id.c_str(), (unsigned long long)session->sim.tick);
+    }
+    return true;
+}
+
+// Grava as sessões abertas em directory e remove os checkpoints das que já expiraram,
+// de modo que o diretório tenha exatamente as sessões do encerramento
+bool save_sessions(const std::string &directory) {
+    bool saved = true;
+    std::unique_lock<registry_mutex_t> lock(sessions_mtx);
+    for (const auto &entry : sessions) {
+        std::lock_guard<session_mutex_t> session_lock(entry.second->mtx);
+        std::string error;
+        if (!save_checkpoint(directory + "/" + entry.first + CHECKPOINT_EXTENSION, entry.second->sim, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            saved = false;
+        }
+    }
+    std::error_code error_code;
+    for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory, error_code)) {
+        if (entry.path().extension() == CHECKPOINT_EXTENSION && sessions.count(entry.path().stem().string()) == 0) {
+            std::filesystem::remove(entry.path(), error_code);
+        }
+    }
+    return saved;
+}
+
+// Contadores de um lock em JSON, com os tempos em segundos
+nlohmann::json lock_counts_json(const lock_counts_t &counts) {
+    return {{"acquisitions", counts.acquisitions}, {"contended", counts.contended}, {"wait_seconds", counts.wait_ns / 1e9}, {"hold_seconds", counts.hold_ns / 1e9}};
+}
+
+int main(int argc, char **argv) {
+    // Threads que atendem as requisições (padrão: uma por núcleo). As rotas só
+    // compartilham o registro de sessões; cada sessão tem o seu próprio lock.
+    unsigned http_threads = std::max(1u, std::thread::hardware_concurrency());
+    uint16_t port = 8080;
+    // Métricas ligadas por padrão; --no-metrics tira a medição do caminho das iterações.
+    // O rastreamento (/trace) é desligado por padrão; --trace o liga.
+    bool with_metrics = true;
+    bool with_trace = false;
+    // Com --checkpoint-dir, as sessões são gravadas no diretório ao encerrar e restauradas ao iniciar
+    std::string checkpoint_dir;
+    // Diretório dos snapshots de /snapshot e /fork (desligados sem --snapshot-dir)
+    std::string snapshot_dir;
+    for (int k = 1; k < argc; k++) {
+        std::string arg = argv[k];
+        if (arg == "--http-threads" && k + 1 < argc && std::atoi(argv[k + 1]) > 0) {
+            http_threads = std::atoi(argv[++k]);
+        } else if (arg == "--port" && k + 1 < argc && std::atoi(argv[k + 1]) > 0 && std::atoi(argv[k + 1]) <= UINT16_MAX) {
+            port = std::atoi(argv[++k]);
+        } else if (arg == "--no-metrics") {
+            with_metrics = false;
+        } else if (arg == "--trace") {
+            with_trace = true;
+        } else if (arg == "--checkpoint-dir" && k + 1 < argc) {
+            checkpoint_dir = argv[++k];
+        } else if (arg == "--snapshot-dir" && k + 1 < argc) {
+            snapshot_dir = argv[++k];
+        } else {
+            std::fprintf(stderr, "usage: %s [--http-threads N] [--port P] [--no-metrics] [--trace] [--checkpoint-dir DIR] [--snapshot-dir DIR]\n", argv[0]);
+            return 1;
+        }
+    }
+    metrics_enabled = with_metrics;
+    tracing_enabled = with_trace;
+    if (!checkpoint_dir.empty() && !restore_sessions(checkpoint_dir)) {
+        return 1;
+    }
+    std::error_code snapshot_dir_error;
+    if (!snapshot_dir.empty() && !std::filesystem::create_directories(snapshot_dir, snapshot_dir_error) && snapshot_dir_error) {
+        std::fprintf(stderr, "%s: %s\n", snapshot_dir.c_str(), snapshot_dir_error.message().c_str());
+        return 1;
+    }
+    crow::App<request_metrics_t> app;
+    // Pool de threads criado uma única vez, reaproveitado em todas as iterações
+    thread_pool_t worker_pool(std::thread::hardware_concurrency());
 
     // Endpoint que serve a página HTML
     CROW_ROUTE(app, "/")
@@ -296,87 +635,454 @@ int main() {
         res.end(); 
     });
 
+    // Métricas no formato de texto do Prometheus
+    CROW_ROUTE(app, "/metrics")
+    ([](crow::request &, crow::response &res) {
+        if (!metrics_enabled.load(std::memory_order_relaxed)) {
+            res.code = 404;
+            res.body = "Metrics disabled";
+            res.end();
+            return;
+        }
+        write_simulation_metrics(res.body);
+        write_server_metrics(res.body);
+        res.set_header("Content-Type", "text/plain; version=0.0.4");
+        res.end();
+    });
+
+    // Últimos eventos de rastreamento de cada thread, no formato Trace Event do Chrome
+    CROW_ROUTE(app, "/trace")
+    ([](crow::request &, crow::response &res) {
+        if (!tracing_enabled.load(std::memory_order_relaxed)) {
+            res.code = 404;
+            res.body = "Tracing disabled";
+            res.end();
+            return;
+        }
+        write_trace_json(res.body);
+        res.set_header("Content-Type", "application/json");
+        res.end();
+    });
+
+    // Contadores dos locks desde o início do servidor ou, com session, do entity_mtx
+    // da sessão na sua última iteração
+    CROW_ROUTE(app, "/locks")
+    ([](crow::request &req, crow::response &res) {
+        if (!metrics_enabled.load(std::memory_order_relaxed)) {
+            res.code = 404;
+            res.body = "Metrics disabled";
+            res.end();
+            return;
+        }
+        nlohmann::json body;
+        if (req.url_params.get("session") != nullptr) {
+            std::shared_ptr<session_t> session = find_session(req, res);
+            if (session == nullptr) {
+                res.end();
+                return;
+            }
+            std::lock_guard<session_mutex_t> lock(session->mtx);
+            body = {{"tick", session->sim.tick}, {"entity_mtx", lock_counts_json(session->sim.last_tick_entity_lock)}};
+        } else {
+            body = {{"entity_mtx", lock_counts_json(entity_lock_totals.snapshot())},
+                    {"session", lock_counts_json(session_lock_stats.snapshot())},
+                    {"registry", lock_counts_json(registry_lock_stats.snapshot())}};
+        }
+        res.set_header("Content-Type", "application/json");
+        res.body = body.dump();
+        res.end();
+    });
+
     // Endpoint que inicia a simulação, com os parâmetros estabelecidos
     CROW_ROUTE(app, "/start-simulation").methods("POST"_method)([](crow::request &req, crow::response &res) {
         // Faz o parse no body do JSON
         nlohmann::json request_body = nlohmann::json::parse(req.body);
-        // Valida o número total de entidades no body
-        uint32_t total_entities = (uint32_t)request_body["plants"] + (uint32_t)request_body["herbivores"] + (uint32_t)request_body["carnivores"];
-        if (total_entities > NUM_ROWS * NUM_ROWS) {
+        // Valida as dimensões do grid (opcionais, altura x largura) ainda no JSON: a conversão
+        // direta para uint32_t truncaria valores grandes e não aceita strings
+        uint32_t num_rows = DEFAULT_NUM_ROWS;
+        uint32_t num_columns = DEFAULT_NUM_COLUMNS;
+        for (auto [name, dimension] : {std::pair<const char *, uint32_t *>{"height", &num_rows}, {"width", &num_columns}}) {
+            if (!request_body.contains(name)) {
+                continue;
+            }
+            const nlohmann::json &value = request_body[name];
+            if (!value.is_number_unsigned() || value.get<uint64_t>() == 0 || value.get<uint64_t>() > MAXIMUM_GRID_DIMENSION) {
+                res.code = 400;
+                res.body = "Invalid grid dimensions";
+                res.end();
+                return;
+            }
+            *dimension = value.get<uint32_t>();
+        }
+        // Valida o número de entidades de cada tipo e o total no body. Cada contagem é limitada
+        // ao número de células antes da soma, que assim não estoura
+        uint64_t num_cells = (uint64_t)num_rows * num_columns;
+        uint64_t total_entities = 0;
+        for (const char *name : {"plants", "herbivores", "carnivores"}) {
+            const nlohmann::json &count = request_body[name];
+            if (!count.is_number_unsigned() || count.get<uint64_t>() > num_cells) {
+                res.code = 400;
+                res.body = std::string("Invalid number of ") + name;
+                res.end();
+                return;
+            }
+            total_entities += count.get<uint64_t>();
+        }
+        if (total_entities > num_cells) {
             res.code = 400;
             res.body = "Too many entities";
             res.end();
             return;
         }
-        // Limpa o grid de entidades
-        entity_grid.clear();
-        entity_grid.assign(NUM_ROWS, std::vector<entity_t>(NUM_ROWS, { empty, 0, 0 }));
-        std::uniform_int_distribution<> distribution(0, 14);
-        // Função para criar uma entidade em uma posição aleatória
-        auto create_entity = [&](entity_type_t type, int energy) {
-            int line, column;
-            do {
-                line = distribution(generator);
-                column = distribution(generator);
-            } while (entity_grid[line][column].type != empty);
-            entity_grid[line][column] = {type, energy, 0};
-        };
-        // Criação das plantas
-        for (uint32_t i = 0; i < (uint32_t)request_body["plants"]; i++) {
-            create_entity(plant, 0);
-        }
-        // Criação dos herbívoros
-        for (uint32_t i = 0; i < (uint32_t)request_body["herbivores"]; i++) {
-            create_entity(herbivore, 100);
-        }
-        // Criação dos carnívoros
-        for (uint32_t i = 0; i < (uint32_t)request_body["carnivores"]; i++) {
-            create_entity(carnivore, 100);
-        }
-        // Retorna o JSON que representa o grid de entidades
-        nlohmann::json json_grid = entity_grid;
-        res.body = json_grid.dump();
+        // Semente opcional (inteiro sem sinal ou string só de dígitos decimais, para clientes sem
+        // inteiros de 64 bits); sem ela, uma nova semente é sorteada
+        uint64_t seed_value = random_u64();
+        if (request_body.contains("seed")) {
+            const nlohmann::json &seed = request_body["seed"];
+            if (seed.is_number_unsigned()) {
+                seed_value = seed.get<uint64_t>();
+            } else if (!seed.is_string() || !parse_unsigned(seed.get<std::string>(), seed_value)) {
+                res.code = 400;
+                res.body = "Invalid seed";
+                res.end();
+                return;
+            }
+        }
+        // Modo de atualização opcional (padrão: sequential); a conversão do enum levaria um nome
+        // desconhecido para o primeiro valor, então o nome é conferido antes
+        update_mode_t mode = sequential;
+        if (request_body.contains("mode")) {
+            const nlohmann::json &mode_name = request_body["mode"];
+            if (mode_name != "sequential" && mode_name != "checkerboard") {
+                res.code = 400;
+                res.body = "Invalid mode";
+                res.end();
+                return;
+            }
+            mode = mode_name.get<update_mode_t>();
+        }
+        // Regras opcionais: um objeto com os parâmetros a alterar (ver rules.h)
+        rules_t rules;
+        if (request_body.contains("rules")) {
+            const nlohmann::json &overrides = request_body["rules"];
+            if (!overrides.is_object()) {
+                res.code = 400;
+                res.body = "Invalid rules";
+                res.end();
+                return;
+            }
+            for (auto it = overrides.begin(); it != overrides.end(); ++it) {
+                const rule_field_t *field = find_rule(it.key());
+                if (field == nullptr) {
+                    res.code = 400;
+                    res.body = "Unknown rule: " + it.key();
+                    res.end();
+                    return;
+                }
+                if (!it.value().is_number() || !rule_accepts(*field, it.value().get<double>())) {
+                    res.code = 400;
+                    res.body = "Invalid rule: " + it.key();
+                    res.end();
+                    return;
+                }
+                set_rule(rules, *field, it.value().get<double>());
+            }
+        }
+        // Cada chamada cria uma sessão nova, com a sua própria simulação
+        std::shared_ptr<session_t> session = std::make_shared<session_t>();
+        setup_simulation(session->sim, num_rows, num_columns, request_body["plants"], request_body["herbivores"], request_body["carnivores"], seed_value, mode,
+                         rules);
+        session->last_used = std::chrono::steady_clock::now();
+        if (!register_session(session)) {
+            res.code = 503;
+            res.body = "Too many sessions";
+            res.end();
+            return;
+        }
+        // Retorna o grid de entidades, e a sessão e a semente usada nos cabeçalhos
+        res.set_header("X-Ecosim-Session", session->id);
+        res.set_header("X-Ecosim-Seed", std::to_string(seed_value));
+        write_grid_response(req, res, session->sim);
+        res.end();
+    });
+
+    // Endpoint para avançar a simulação da sessão para a próxima iteração
+    CROW_ROUTE(app, "/next-iteration").methods("GET"_method)([&worker_pool](const crow::request &req, crow::response &res) {
+        std::shared_ptr<session_t> session = find_session(req, res);
+        if (session == nullptr) {
+            res.end();
+            return;
+        }
+        uint64_t base;
+        if (!parse_base_tick(req, base)) {
+            res.code = 400;
+            res.body = "Invalid base tick";
+            res.end();
+            return;
+        }
+        std::lock_guard<session_mutex_t> lock(session->mtx);
+        session->last_used = std::chrono::steady_clock::now();
+        advance_simulation(session->sim, worker_pool);
+        // Retorna a representação do grid em JSON ou binário
+        write_grid_response(req, res, session->sim);
+        broadcast_frames(*session);
+        res.end();
+    });
+
+    // Endpoint para avançar várias iterações de uma vez e retornar só o estado final
+    CROW_ROUTE(app, "/advance").methods("GET"_method)([&worker_pool](const crow::request &req, crow::response &res) {
+        std::shared_ptr<session_t> session = find_session(req, res);
+        if (session == nullptr) {
+            res.end();
+            return;
+        }
+        // Número de iterações (padrão: 1)
+        uint64_t steps = 1;
+        if (req.url_params.get("steps") != nullptr && !parse_unsigned(req.url_params.get("steps"), steps)) {
+            steps = 0;
+        }
+        if (steps == 0 || steps > MAXIMUM_ADVANCE_STEPS) {
+            res.code = 400;
+            res.body = "Invalid number of steps";
+            res.end();
+            return;
+        }
+        uint64_t base;
+        if (!parse_base_tick(req, base)) {
+            res.code = 400;
+            res.body = "Invalid base tick";
+            res.end();
+            return;
+        }
+        // Com populations=1, a resposta (sempre em JSON) inclui a população de cada iteração
+        bool with_populations = req.url_params.get("populations") != nullptr && std::string(req.url_params.get("populations")) == "1";
+        std::lock_guard<session_mutex_t> lock(session->mtx);
+        session->last_used = std::chrono::steady_clock::now();
+        simulation_t &sim = session->sim;
+        nlohmann::json populations = nlohmann::json::array();
+        for (uint64_t step = 0; step < steps; step++) {
+            advance_simulation(sim, worker_pool);
+            if (with_populations) {
+                population_t population = count_population(sim.grid);
+                populations.push_back({{"tick", sim.tick}, {"plants", population.plants}, {"herbivores", population.herbivores}, {"carnivores", population.carnivores}});
+            }
+        }
+        if (with_populations) {
+            // Mesmo formato (chaves em ordem alfabética) que o nlohmann::json emitiria
+            res.body = "{\"grid\":";
+            write_grid_json(res.body, sim.grid);
+            res.body += ",\"populations\":" + populations.dump() + ",\"tick\":" + std::to_string(sim.tick) + "}";
+        } else {
+            write_grid_response(req, res, sim);
+        }
+        broadcast_frames(*session);
+        res.end();
+    });
+
+    // Checkpoint da simulação da sessão (ver checkpoint.h), para ser restaurado depois em /restore
+    CROW_ROUTE(app, "/checkpoint").methods("GET"_method)([](const crow::request &req, crow::response &res) {
+        std::shared_ptr<session_t> session = find_session(req, res);
+        if (session == nullptr) {
+            res.end();
+            return;
+        }
+        std::lock_guard<session_mutex_t> lock(session->mtx);
+        session->last_used = std::chrono::steady_clock::now();
+        write_checkpoint(res.body, session->sim);
+        res.set_header("Content-Type", "application/octet-stream");
+        res.set_header("Content-Disposition", "attachment; filename=\"ecosim-" + session->id + "-" + std::to_string(session->sim.tick) + ".ckpt\"");
+        res.end();
+    });
+
+    // Cria uma sessão a partir do checkpoint enviado no body. A resposta é a mesma do
+    // /start-simulation, com a iteração restaurada também no cabeçalho X-Ecosim-Tick.
+    CROW_ROUTE(app, "/restore").methods("POST"_method)([](crow::request &req, crow::response &res) {
+        // As dimensões são conferidas no cabeçalho, antes que read_checkpoint aloque o grid
+        uint32_t rows, columns;
+        if (checkpoint_dimensions(req.body.data(), req.body.size(), rows, columns) &&
+            (rows > MAXIMUM_GRID_DIMENSION || columns > MAXIMUM_GRID_DIMENSION)) {
+            res.code = 400;
+            res.body = "Invalid grid dimensions";
+            res.end();
+            return;
+        }
+        std::shared_ptr<session_t> session = std::make_shared<session_t>();
+        std::string error;
+        if (!read_checkpoint(req.body.data(), req.body.size(), session->sim, error)) {
+            res.code = 400;
+            res.body = "Invalid checkpoint: " + error;
+            res.end();
+            return;
+        }
+        session->last_used = std::chrono::steady_clock::now();
+        if (!register_session(session)) {
+            res.code = 503;
+            res.body = "Too many sessions";
+            res.end();
+            return;
+        }
+        res.set_header("X-Ecosim-Session", session->id);
+        res.set_header("X-Ecosim-Seed", std::to_string(session->sim.seed));
+        res.set_header("X-Ecosim-Tick", std::to_string(session->sim.tick));
+        write_grid_response(req, res, session->sim);
         res.end();
     });
 
-    // Endpoint para avançar a simulação para a próxima iteração
-    CROW_ROUTE(app, "/next-iteration").methods("GET"_method)([]() {
-        bool analyzed = false;
-        for (uint32_t i = 0; i < NUM_ROWS; i++) {
-            for (uint32_t j = 0; j < NUM_ROWS; j++) {
-                // Verifica se a posição no grid já foi analisada
-                analyzed = false;
-                for (int k = 0; k < analyzed_pos.size(); k++) {
-                    if (analyzed_pos[k].first == i && analyzed_pos[k].second == j) {
-                        analyzed = true;
+    // Grava a simulação da sessão como o snapshot name no --snapshot-dir (ver snapshot.h)
+    CROW_ROUTE(app, "/snapshot").methods("POST"_method)([&snapshot_dir](const crow::request &req, crow::response &res) {
+        if (snapshot_dir.empty()) {
+            res.code = 404;
+            res.body = "Snapshots disabled";
+            res.end();
+            return;
+        }
+        const char *name = req.url_params.get("name");
+        if (!valid_snapshot_name(name)) {
+            res.code = 400;
+            res.body = "Invalid snapshot name";
+            res.end();
+            return;
+        }
+        std::shared_ptr<session_t> session = find_session(req, res);
+        if (session == nullptr) {
+            res.end();
+            return;
+        }
+        std::lock_guard<session_mutex_t> lock(session->mtx);
+        session->last_used = std::chrono::steady_clock::now();
+        std::string error;
+        if (!save_snapshot(snapshot_dir + "/" + name + SNAPSHOT_EXTENSION, session->sim, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            res.code = 500;
+            res.body = "Snapshot failed";
+            res.end();
+            return;
+        }
+        res.set_header("Content-Type", "application/json");
+        res.body = nlohmann::json{{"snapshot", name}, {"tick", session->sim.tick}}.dump();
+        res.end();
+    });
+
+    // Cria uma sessão mapeando o snapshot name: as células não são copiadas, então o fork de
+    // um mundo grande leva milissegundos, e sessões do mesmo snapshot compartilham as páginas
+    // que ainda não mudaram. Com verify=1, o checksum e o conteúdo das células são conferidos. A
+    // resposta não traz o grid, para não percorrer as células: {"session", "tick"}.
+    CROW_ROUTE(app, "/fork").methods("POST"_method)([&snapshot_dir](const crow::request &req, crow::response &res) {
+        if (snapshot_dir.empty()) {
+            res.code = 404;
+            res.body = "Snapshots disabled";
+            res.end();
+            return;
+        }
+        const char *name = req.url_params.get("snapshot");
+        if (!valid_snapshot_name(name)) {
+            res.code = 400;
+            res.body = "Invalid snapshot name";
+            res.end();
+            return;
+        }
+        std::string path = snapshot_dir + "/" + name + SNAPSHOT_EXTENSION;
+        if (!std::filesystem::exists(path)) {
+            res.code = 404;
+            res.body = "Unknown snapshot";
+            res.end();
+            return;
+        }
+        bool verify = req.url_params.get("verify") != nullptr && std::string(req.url_params.get("verify")) == "1";
+        std::shared_ptr<session_t> session = std::make_shared<session_t>();
+        std::string error;
+        if (!load_snapshot(path, session->sim, verify, MAXIMUM_GRID_DIMENSION, error)) {
+            std::fprintf(stderr, "%s\n", error.c_str());
+            res.code = 400;
+            res.body = "Invalid snapshot";
+            res.end();
+            return;
+        }
+        session->last_used = std::chrono::steady_clock::now();
+        if (!register_session(session)) {
+            res.code = 503;
+            res.body = "Too many sessions";
+            res.end();
+            return;
+        }
+        res.set_header("X-Ecosim-Session", session->id);
+        res.set_header("X-Ecosim-Seed", std::to_string(session->sim.seed));
+        res.set_header("X-Ecosim-Tick", std::to_string(session->sim.tick));
+        res.set_header("Content-Type", "application/json");
+        res.body = nlohmann::json{{"session", session->id}, {"tick", session->sim.tick}}.dump();
+        res.end();
+    });
+
+    // WebSocket que recebe os quadros binários de uma sessão a cada iteração: o
+    // grid completo ao se inscrever e depois deltas. O cliente se inscreve e escolhe
+    // o ritmo com a mensagem {"session": "<id>", "interval_ms": N} (0 pausa); o ritmo
+    // é compartilhado pelos clientes da sessão, e o relógio dela para quando o
+    // último se desconecta.
+    CROW_ROUTE(app, "/ws")
+        .websocket()
+        .onopen([](crow::websocket::connection &connection) {
+            // O ponteiro de userdata guarda a sessão em que o cliente está inscrito
+            connection.userdata(nullptr);
+        })
+        .onmessage([](crow::websocket::connection &connection, const std::string &data, bool) {
+            nlohmann::json message = nlohmann::json::parse(data, nullptr, false);
+            if (!message.is_object() || (message.contains("session") && !message["session"].is_string()) ||
+                (message.contains("interval_ms") && !message["interval_ms"].is_number_unsigned())) {
+                connection.send_text("Invalid message");
+                return;
+            }
+            if (message.contains("session")) {
+                std::shared_ptr<session_t> session;
+                {
+                    std::shared_lock<registry_mutex_t> lock(sessions_mtx);
+                    auto found = sessions.find(message["session"].get<std::string>());
+                    if (found != sessions.end()) {
+                        session = found->second;
                     }
                 }
-                // Caso a posição no grid não tenha sido analisada
-                if (!analyzed) {
-                    // Caso a entidade seja do tipo planta
-                    if (entity_grid[i][j].type == plant) {
-                        std::thread tplant(plant_thread, i, j);
-                        tplant.join();
-                    } 
-                    // Caso a entidade seja do tipo herbívoro
-                    else if (entity_grid[i][j].type == herbivore) {
-                        std::thread therbivore(herbivore_thread, i, j);
-                        therbivore.join();
-                    } 
-                    // Caso a entidade seja do tipo carnívoro
-                    else if (entity_grid[i][j].type == carnivore) {
-                        std::thread tcarnivore(carnivore_thread, i, j);
-                        tcarnivore.join();
-                    }
+                if (session == nullptr) {
+                    connection.send_text("Unknown session");
+                    return;
+                }
+                std::shared_ptr<session_t> *current = static_cast<std::shared_ptr<session_t> *>(connection.userdata());
+                if (current == nullptr || *current != session) {
+                    unsubscribe_viewer(connection);
+                    connection.userdata(new std::shared_ptr<session_t>(session));
+                    std::lock_guard<session_mutex_t> lock(session->mtx);
+                    session->viewers.push_back({&connection, std::make_shared<std::atomic<bool>>(true), 0, false});
+                    broadcast_frames(*session);
                 }
             }
-        }
-        analyzed_pos.clear();
-        // Retorna a representação do grid em JSON
-        nlohmann::json json_grid = entity_grid; 
-        return json_grid.dump(); 
-    });
+            std::shared_ptr<session_t> *subscription = static_cast<std::shared_ptr<session_t> *>(connection.userdata());
+            if (subscription == nullptr) {
+                connection.send_text("Unknown session");
+                return;
+            }
+            if (message.contains("interval_ms")) {
+                uint64_t interval_ms = message["interval_ms"];
+                if (interval_ms != 0 && (interval_ms < MINIMUM_TICK_INTERVAL_MS || interval_ms > MAXIMUM_TICK_INTERVAL_MS)) {
+                    connection.send_text("Invalid interval");
+                    return;
+                }
+                set_tick_interval(*subscription, (uint32_t)interval_ms);
+            }
+        })
+        .onclose([](crow::websocket::connection &connection, const std::string &) {
+            unsubscribe_viewer(connection);
+        });
+
+    std::thread ticker([&worker_pool]() { ticker_loop(worker_pool); });
     // Roda o servidor
-    app.port(8080).run();
+    // O Crow usa uma thread a mais para aceitar as conexões
+    app.port(port).concurrency(std::min<unsigned>(http_threads + 1, UINT16_MAX)).run();
+    {
+        std::lock_guard<std::mutex> lock(ticker_mtx);
+        ticker_stopping = true;
+    }
+    ticker_cv.notify_one();
+    ticker.join();
+    if (!checkpoint_dir.empty() && !save_sessions(checkpoint_dir)) {
+        return 1;
+    }
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,109 @@
+#include "metrics.h"
+#include "grid.h"
+#include <charconv>
+
+const double TICK_BUCKETS[] = {0.00001, 0.00005, 0.0001, 0.0005, 0.001, 0.005, 0.01, 0.05, 0.1, 0.5, 1, 5};
+const size_t NUM_TICK_BUCKETS = sizeof(TICK_BUCKETS) / sizeof(TICK_BUCKETS[0]);
+const double ENTITY_BUCKETS[] = {0.0000001, 0.00000025, 0.0000005, 0.000001, 0.0000025, 0.000005, 0.00001, 0.00005, 0.0001};
+const size_t NUM_ENTITY_BUCKETS = sizeof(ENTITY_BUCKETS) / sizeof(ENTITY_BUCKETS[0]);
+
+const char *const ENTITY_TYPE_LABELS[4] = {"empty", "plant", "herbivore", "carnivore"};
+
+simulation_metrics_t simulation_metrics;
+std::atomic<bool> metrics_enabled{false};
+
+histogram_t::histogram_t(const double *bounds, size_t num_bounds)
+    : bounds(bounds), num_bounds(num_bounds), counts(new std::atomic<uint64_t>[num_bounds + 1]()) {
+}
+
+void histogram_t::observe(std::chrono::steady_clock::duration elapsed) {
+    uint64_t nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    double seconds = nanoseconds * 1e-9;
+    size_t bucket = 0;
+    while (bucket < num_bounds && seconds > bounds[bucket]) {
+        bucket++;
+    }
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    sum_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+}
+
+// Acrescenta um número ao texto, na forma mais curta que o representa exatamente
+static void append_number(std::string &out, double value) {
+    char buffer[32];
+    std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+void histogram_t::write(std::string &out, const char *name, const std::string &labels) const {
+    // As faixas do Prometheus são cumulativas: cada uma conta as observações até o seu limite
+    std::string prefix = labels.empty() ? "" : labels + ",";
+    uint64_t cumulative = 0;
+    for (size_t k = 0; k <= num_bounds; k++) {
+        cumulative += counts[k].load(std::memory_order_relaxed);
+        out += name;
+        out += "_bucket{" + prefix + "le=\"";
+        if (k < num_bounds) {
+            append_number(out, bounds[k]);
+        } else {
+            out += "+Inf";
+        }
+        out += "\"} " + std::to_string(cumulative) + "\n";
+    }
+    write_sample(out, (std::string(name) + "_sum").c_str(), labels, sum_ns.load(std::memory_order_relaxed) / 1e9);
+    write_sample(out, (std::string(name) + "_count").c_str(), labels, cumulative);
+}
+
+void write_metric_header(std::string &out, const char *name, const char *type, const char *help) {
+    out += "# HELP ";
+    out += name;
+    out += " ";
+    out += help;
+    out += "\n# TYPE ";
+    out += name;
+    out += " ";
+    out += type;
+    out += "\n";
+}
+
+void write_sample(std::string &out, const char *name, const std::string &labels, double value) {
+    out += name;
+    if (!labels.empty()) {
+        out += "{" + labels + "}";
+    }
+    out += " ";
+    append_number(out, value);
+    out += "\n";
+}
+
+simulation_metrics_t::simulation_metrics_t()
+    : tick_seconds(TICK_BUCKETS, NUM_TICK_BUCKETS), aging_seconds(TICK_BUCKETS, NUM_TICK_BUCKETS), update_seconds(TICK_BUCKETS, NUM_TICK_BUCKETS),
+      history_seconds(TICK_BUCKETS, NUM_TICK_BUCKETS),
+      entity_seconds{{ENTITY_BUCKETS, NUM_ENTITY_BUCKETS}, {ENTITY_BUCKETS, NUM_ENTITY_BUCKETS}, {ENTITY_BUCKETS, NUM_ENTITY_BUCKETS}, {ENTITY_BUCKETS, NUM_ENTITY_BUCKETS}},
+      births(), moves(), eats() {
+}
+
+// Escreve um contador com uma amostra por tipo de entidade, a partir de first_type
+static void write_per_type(std::string &out, const char *name, const char *help, const std::atomic<uint64_t> *values, int first_type) {
+    write_metric_header(out, name, "counter", help);
+    for (int type = first_type; type < 4; type++) {
+        write_sample(out, name, std::string("type=\"") + ENTITY_TYPE_LABELS[type] + "\"", values[type].load(std::memory_order_relaxed));
+    }
+}
+
+void write_simulation_metrics(std::string &out) {
+    write_metric_header(out, "ecosim_tick_duration_seconds", "histogram", "Duration of a whole simulation tick.");
+    simulation_metrics.tick_seconds.write(out, "ecosim_tick_duration_seconds", "");
+    write_metric_header(out, "ecosim_tick_phase_duration_seconds", "histogram", "Duration of each phase of a simulation tick.");
+    simulation_metrics.aging_seconds.write(out, "ecosim_tick_phase_duration_seconds", "phase=\"aging\"");
+    simulation_metrics.update_seconds.write(out, "ecosim_tick_phase_duration_seconds", "phase=\"update\"");
+    simulation_metrics.history_seconds.write(out, "ecosim_tick_phase_duration_seconds", "phase=\"history\"");
+    write_metric_header(out, "ecosim_entity_update_duration_seconds", "histogram", "Duration of a single entity update, sampled.");
+    for (int type = plant; type < 4; type++) {
+        simulation_metrics.entity_seconds[type].write(out, "ecosim_entity_update_duration_seconds", std::string("type=\"") + ENTITY_TYPE_LABELS[type] + "\"");
+    }
+    write_per_type(out, "ecosim_births_total", "Entities born, by type.", simulation_metrics.births, plant);
+    write_per_type(out, "ecosim_moves_total", "Animal moves, by type.", simulation_metrics.moves, herbivore);
+    write_per_type(out, "ecosim_eats_total", "Prey eaten, by type of the eater.", simulation_metrics.eats, herbivore);
+    write_metric_header(out, "ecosim_aging_deaths_total", "counter", "Entities that died of old age or starvation.");
+    write_sample(out, "ecosim_aging_deaths_total", "", simulation_metrics.aging_deaths.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,83 @@
+/*
+    Métricas no formato de texto do Prometheus, expostas pelo servidor em
+    /metrics.
+
+    O caminho quente só faz somas atômicas relaxadas: um histograma tem um
+    contador por faixa, a soma em nanossegundos e o total de observações, e
+    a exposição monta o texto a partir desses contadores. As métricas da
+    simulação (iterações, fases e eventos das entidades) ficam no núcleo,
+    em simulation_metrics, e só são registradas com metrics_enabled ligado.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Limites das faixas (em segundos) usados pelos histogramas
+extern const double TICK_BUCKETS[];
+extern const size_t NUM_TICK_BUCKETS;
+extern const double ENTITY_BUCKETS[];
+extern const size_t NUM_ENTITY_BUCKETS;
+
+class histogram_t {
+public:
+    // bounds deve ter num_bounds limites em ordem crescente e viver tanto quanto o histograma
+    histogram_t(const double *bounds, size_t num_bounds);
+
+    void observe(std::chrono::steady_clock::duration elapsed);
+
+    // Escreve as linhas _bucket, _sum e _count; labels é "" ou uma lista como type="plant"
+    void write(std::string &out, const char *name, const std::string &labels) const;
+
+private:
+    const double *bounds;
+    size_t num_bounds;
+    // num_bounds + 1 contadores: o último é a faixa +Inf
+    std::unique_ptr<std::atomic<uint64_t>[]> counts;
+    std::atomic<uint64_t> sum_ns{0};
+};
+
+// Escreve as linhas # HELP e # TYPE de uma métrica
+void write_metric_header(std::string &out, const char *name, const char *type, const char *help);
+
+// Escreve uma amostra "nome{labels} valor"
+void write_sample(std::string &out, const char *name, const std::string &labels, double value);
+
+// Tipos de entidade nos rótulos, indexados por entity_type_t
+extern const char *const ENTITY_TYPE_LABELS[4];
+
+// Métricas do núcleo da simulação, somadas entre todas as simulações do processo
+struct simulation_metrics_t {
+    simulation_metrics_t();
+
+    // Duração de uma iteração completa e de cada fase: envelhecimento, atualização
+    // das entidades e registro do histórico de deltas
+    histogram_t tick_seconds;
+    histogram_t aging_seconds;
+    histogram_t update_seconds;
+    histogram_t history_seconds;
+    // Duração da atualização de uma entidade, por tipo, medida em uma a cada
+    // ENTITY_SAMPLE_INTERVAL atualizações
+    histogram_t entity_seconds[4];
+    // Eventos das entidades, por tipo (o índice de quem nasce, se move ou come)
+    std::atomic<uint64_t> births[4];
+    std::atomic<uint64_t> moves[4];
+    std::atomic<uint64_t> eats[4];
+    // Mortes por idade ou falta de energia, no passo de envelhecimento
+    std::atomic<uint64_t> aging_deaths{0};
+};
+
+// Uma atualização de entidade a cada ENTITY_SAMPLE_INTERVAL é cronometrada
+static const uint32_t ENTITY_SAMPLE_INTERVAL = 64;
+
+extern simulation_metrics_t simulation_metrics;
+// Liga o registro das métricas da simulação (desligado por padrão, como no ecosim-batch)
+extern std::atomic<bool> metrics_enabled;
+
+// Escreve as métricas da simulação no formato do Prometheus
+void write_simulation_metrics(std::string &out);
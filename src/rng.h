@@ -0,0 +1,76 @@
+/*
+    Gerador de números aleatórios baseado em contador (Philox4x32-10).
+
+    Cada sorteio é uma função pura de (semente, iteração, célula, posição do
+    sorteio), então qualquer thread pode sortear para qualquer célula sem
+    estado compartilhado, e o resultado não depende da ordem de execução nem
+    do número de threads.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+// Bloco Philox4x32 com 10 rodadas (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3")
+struct philox4x32_t {
+    uint32_t values[4];
+
+    static philox4x32_t generate(const uint32_t counter[4], const uint32_t key[2]) {
+        const uint32_t MULTIPLIER_0 = 0xD2511F53;
+        const uint32_t MULTIPLIER_1 = 0xCD9E8D57;
+        const uint32_t WEYL_0 = 0x9E3779B9;
+        const uint32_t WEYL_1 = 0xBB67AE85;
+        uint32_t c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++) {
+            uint64_t product0 = (uint64_t)MULTIPLIER_0 * c0;
+            uint64_t product1 = (uint64_t)MULTIPLIER_1 * c2;
+            c0 = (uint32_t)(product1 >> 32) ^ c1 ^ k0;
+            c1 = (uint32_t)product1;
+            c2 = (uint32_t)(product0 >> 32) ^ c3 ^ k1;
+            c3 = (uint32_t)product0;
+            k0 += WEYL_0;
+            k1 += WEYL_1;
+        }
+        return {{c0, c1, c2, c3}};
+    }
+};
+
+// Sequência de sorteios de uma célula em uma iteração
+class cell_rng_t {
+public:
+    cell_rng_t(uint64_t seed, uint64_t tick, uint64_t cell) {
+        key[0] = (uint32_t)seed;
+        key[1] = (uint32_t)(seed >> 32);
+        counter[0] = 0;
+        counter[1] = (uint32_t)cell;
+        counter[2] = (uint32_t)tick;
+        counter[3] = (uint32_t)(tick >> 32) ^ (uint32_t)(cell >> 32);
+    }
+
+    uint32_t next_u32() {
+        // Cada bloco Philox rende quatro sorteios; a posição do bloco vai no contador
+        if (available == 0) {
+            block = philox4x32_t::generate(counter, key);
+            counter[0]++;
+            available = 4;
+        }
+        return block.values[4 - available--];
+    }
+
+    // Valor uniforme em [0, 1)
+    double next_double() {
+        return next_u32() * (1.0 / 4294967296.0);
+    }
+
+    // Valor uniforme em [0, n)
+    uint32_t next_below(uint32_t n) {
+        return (uint32_t)(((uint64_t)next_u32() * n) >> 32);
+    }
+
+private:
+    uint32_t key[2];
+    uint32_t counter[4];
+    philox4x32_t block;
+    int available = 0;
+};
@@ -0,0 +1,65 @@
+#include "rules.h"
+#include <cmath>
+
+// Limites das idades máximas e das quantidades de energia, escolhidos para que a energia
+// caiba nos 23 bits do layout packed. Um animal ganha no máximo 4 vezes o ganho ao comer
+// por iteração (um por vizinho), em no máximo MAXIMUM_RULE_AGE + 1 iterações de vida,
+// partindo da energia inicial; os custos só a reduzem, e o animal morre com energia <= 0.
+static const int32_t MAXIMUM_RULE_AGE = 127;
+static const int32_t MAXIMUM_RULE_ENERGY = 8000;
+static_assert(MAXIMUM_RULE_AGE <= (int32_t)packed_cell_t::AGE_MASK, "maximum age must fit the packed age bits");
+static_assert(MAXIMUM_RULE_ENERGY + 4 * (MAXIMUM_RULE_AGE + 1) * MAXIMUM_RULE_ENERGY <= packed_cell_t::MAXIMUM_ENERGY,
+              "the largest energy an animal can reach must fit the packed energy bits");
+
+const rule_field_t RULE_FIELDS[] = {
+    {"plant_reproduction_probability", &rules_t::plant_reproduction_probability, nullptr, 0, 1},
+    {"herbivore_reproduction_probability", &rules_t::herbivore_reproduction_probability, nullptr, 0, 1},
+    {"carnivore_reproduction_probability", &rules_t::carnivore_reproduction_probability, nullptr, 0, 1},
+    {"herbivore_move_probability", &rules_t::herbivore_move_probability, nullptr, 0, 1},
+    {"herbivore_eat_probability", &rules_t::herbivore_eat_probability, nullptr, 0, 1},
+    {"carnivore_move_probability", &rules_t::carnivore_move_probability, nullptr, 0, 1},
+    {"carnivore_eat_probability", &rules_t::carnivore_eat_probability, nullptr, 0, 1},
+    {"plant_maximum_age", nullptr, &rules_t::plant_maximum_age, 1, MAXIMUM_RULE_AGE},
+    {"herbivore_maximum_age", nullptr, &rules_t::herbivore_maximum_age, 1, MAXIMUM_RULE_AGE},
+    {"carnivore_maximum_age", nullptr, &rules_t::carnivore_maximum_age, 1, MAXIMUM_RULE_AGE},
+    {"initial_energy", nullptr, &rules_t::initial_energy, 1, MAXIMUM_RULE_ENERGY},
+    {"herbivore_eat_energy", nullptr, &rules_t::herbivore_eat_energy, 0, MAXIMUM_RULE_ENERGY},
+    {"carnivore_eat_energy", nullptr, &rules_t::carnivore_eat_energy, 0, MAXIMUM_RULE_ENERGY},
+    {"reproduction_threshold_energy", nullptr, &rules_t::reproduction_threshold_energy, 0, MAXIMUM_RULE_ENERGY},
+    {"reproduction_energy_cost", nullptr, &rules_t::reproduction_energy_cost, 0, MAXIMUM_RULE_ENERGY},
+    {"move_energy_cost", nullptr, &rules_t::move_energy_cost, 0, MAXIMUM_RULE_ENERGY},
+};
+
+const size_t NUM_RULE_FIELDS = sizeof(RULE_FIELDS) / sizeof(RULE_FIELDS[0]);
+
+const rule_field_t *find_rule(const std::string &name) {
+    for (size_t k = 0; k < NUM_RULE_FIELDS; k++) {
+        if (name == RULE_FIELDS[k].name) {
+            return &RULE_FIELDS[k];
+        }
+    }
+    return nullptr;
+}
+
+bool rule_accepts(const rule_field_t &field, double value) {
+    if (!(value >= field.minimum && value <= field.maximum)) {
+        return false;
+    }
+    return field.real != nullptr || value == std::floor(value);
+}
+
+double get_rule(const rules_t &rules, const rule_field_t &field) {
+    return field.real != nullptr ? rules.*field.real : rules.*field.integer;
+}
+
+void set_rule(rules_t &rules, const rule_field_t &field, double value) {
+    if (field.real != nullptr) {
+        rules.*field.real = value;
+    } else {
+        rules.*field.integer = (int32_t)value;
+    }
+}
+
+aging_rules_t make_aging_rules(const rules_t &rules) {
+    return {{0, rules.plant_maximum_age, rules.herbivore_maximum_age, rules.carnivore_maximum_age}, {false, false, true, true}};
+}
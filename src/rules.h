@@ -0,0 +1,66 @@
+/*
+    Parâmetros das regras da simulação: probabilidades, idades máximas e
+    quantidades de energia. Os valores padrão são os das regras originais.
+
+    Cada parâmetro tem um nome (o do campo), usado no campo "rules" do
+    /start-simulation e nas opções --rule e --sweep do ecosim-batch, e uma
+    faixa de valores válidos.
+*/
+
+#pragma once
+
+#include "aging.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct rules_t {
+    // Probabilidades, por entidade e por iteração (comer: por vizinho)
+    double plant_reproduction_probability = 0.2;
+    double herbivore_reproduction_probability = 0.075;
+    double carnivore_reproduction_probability = 0.025;
+    double herbivore_move_probability = 0.7;
+    double herbivore_eat_probability = 0.9;
+    double carnivore_move_probability = 0.5;
+    double carnivore_eat_probability = 1.0;
+    // Idade em que cada tipo morre (no máximo 127, o limite do layout packed)
+    int32_t plant_maximum_age = 10;
+    int32_t herbivore_maximum_age = 50;
+    int32_t carnivore_maximum_age = 80;
+    // Energia dos animais ao nascer e na colocação inicial
+    int32_t initial_energy = 100;
+    // Energia ganha ao comer uma planta (herbívoro) ou um herbívoro (carnívoro)
+    int32_t herbivore_eat_energy = 30;
+    int32_t carnivore_eat_energy = 20;
+    // Energia mínima para um animal se reproduzir, e o que ele gasta ao se reproduzir e ao se mover
+    int32_t reproduction_threshold_energy = 20;
+    int32_t reproduction_energy_cost = 10;
+    int32_t move_energy_cost = 5;
+};
+
+// Descrição de um parâmetro: exatamente um dos dois ponteiros é não nulo
+struct rule_field_t {
+    const char *name;
+    double rules_t::*real;
+    int32_t rules_t::*integer;
+    double minimum;
+    double maximum;
+};
+
+// Todos os parâmetros, na ordem de rules_t
+extern const rule_field_t RULE_FIELDS[];
+extern const size_t NUM_RULE_FIELDS;
+
+// Parâmetro com esse nome, ou nullptr se ele não existir
+const rule_field_t *find_rule(const std::string &name);
+
+// Indica se value está na faixa do parâmetro (e é inteiro, nos parâmetros inteiros)
+bool rule_accepts(const rule_field_t &field, double value);
+
+// Lê e escreve o valor de um parâmetro; set_rule supõe que rule_accepts(field, value)
+double get_rule(const rules_t &rules, const rule_field_t &field);
+void set_rule(rules_t &rules, const rule_field_t &field, double value);
+
+// Regras do passo de envelhecimento: plantas morrem só de velhice, herbívoros e
+// carnívoros também morrem quando a energia acaba
+aging_rules_t make_aging_rules(const rules_t &rules);
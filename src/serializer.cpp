@@ -0,0 +1,158 @@
+#include "serializer.h"
+#include <charconv>
+#include <cstring>
+
+namespace nlohmann {
+    void to_json(nlohmann::json &j, const entity_t &e) {
+        j = nlohmann::json{{"type", e.type}, {"energy", e.energy}, {"age", e.age}};
+    }
+
+    // O grid é serializado como uma matriz (vetor de linhas)
+    void to_json(nlohmann::json &j, const grid_t &grid) {
+        j = nlohmann::json::array();
+        for (uint32_t i = 0; i < grid.rows; i++) {
+            nlohmann::json row = nlohmann::json::array();
+            for (uint32_t column = 0; column < grid.columns; column++) {
+                row.push_back(grid.get(i, column));
+            }
+            j.push_back(std::move(row));
+        }
+    }
+}
+
+// Tamanho de uma célula vazia, usado para estimar o tamanho da saída
+static const char EMPTY_CELL_JSON[] = "{\"age\":0,\"energy\":0,\"type\":\" \"}";
+static const size_t EMPTY_CELL_JSON_SIZE = sizeof(EMPTY_CELL_JSON) - 1;
+static const char TYPE_CHARACTERS[] = {' ', 'P', 'H', 'C'};
+
+// Escreve uma célula em buffer e retorna o ponteiro para o fim do texto
+static char *write_cell_json(char *buffer, const entity_t &entity) {
+    char *cursor = buffer;
+    std::memcpy(cursor, "{\"age\":", 7);
+    cursor = std::to_chars(cursor + 7, cursor + 7 + 11, entity.age).ptr;
+    std::memcpy(cursor, ",\"energy\":", 10);
+    cursor = std::to_chars(cursor + 10, cursor + 10 + 11, entity.energy).ptr;
+    std::memcpy(cursor, ",\"type\":\"", 9);
+    cursor += 9;
+    *cursor++ = TYPE_CHARACTERS[entity.type];
+    *cursor++ = '"';
+    *cursor++ = '}';
+    return cursor;
+}
+
+void write_grid_json(std::string &out, const grid_t &grid) {
+    // Cada célula ocupa no mínimo o tamanho de uma célula vazia mais a vírgula
+    out.reserve(out.size() + grid.size() * (EMPTY_CELL_JSON_SIZE + 1) + (size_t)grid.rows * 3 + 2);
+    // Espaço para a maior célula possível (idade e energia com 11 caracteres)
+    char cell[64];
+    out.push_back('[');
+    for (uint32_t i = 0; i < grid.rows; i++) {
+        if (i > 0) {
+            out.push_back(',');
+        }
+        out.push_back('[');
+        for (uint32_t j = 0; j < grid.columns; j++) {
+            if (j > 0) {
+                out.push_back(',');
+            }
+            entity_t entity = grid.get(i, j);
+            if (entity.type == empty && entity.energy == 0 && entity.age == 0) {
+                out.append(EMPTY_CELL_JSON, EMPTY_CELL_JSON_SIZE);
+            } else {
+                out.append(cell, write_cell_json(cell, entity) - cell);
+            }
+        }
+        out.push_back(']');
+    }
+    out.push_back(']');
+}
+
+void write_delta_json(std::string &out, const grid_t &grid, const std::vector<uint32_t> &changes, uint64_t base, uint64_t tick) {
+    // Uma mudança ocupa no máximo 81 caracteres (inteiros com até 11)
+    char change[96];
+    out.reserve(out.size() + changes.size() * 64 + 64);
+    out += "{\"base\":";
+    out += std::to_string(base);
+    out += ",\"changes\":[";
+    for (size_t k = 0; k < changes.size(); k++) {
+        if (k > 0) {
+            out.push_back(',');
+        }
+        uint32_t i = changes[k] / grid.columns;
+        uint32_t j = changes[k] % grid.columns;
+        entity_t entity = grid.get(i, j);
+        char *cursor = change;
+        std::memcpy(cursor, "{\"age\":", 7);
+        cursor = std::to_chars(cursor + 7, cursor + 7 + 11, entity.age).ptr;
+        std::memcpy(cursor, ",\"energy\":", 10);
+        cursor = std::to_chars(cursor + 10, cursor + 10 + 11, entity.energy).ptr;
+        std::memcpy(cursor, ",\"i\":", 5);
+        cursor = std::to_chars(cursor + 5, cursor + 5 + 11, i).ptr;
+        std::memcpy(cursor, ",\"j\":", 5);
+        cursor = std::to_chars(cursor + 5, cursor + 5 + 11, j).ptr;
+        std::memcpy(cursor, ",\"type\":\"", 9);
+        cursor += 9;
+        *cursor++ = TYPE_CHARACTERS[entity.type];
+        *cursor++ = '"';
+        *cursor++ = '}';
+        out.append(change, cursor - change);
+    }
+    out += "],\"tick\":";
+    out += std::to_string(tick);
+    out.push_back('}');
+}
+
+// Inteiros em little-endian, independentemente da arquitetura
+static void append_u16(std::string &out, uint16_t value) {
+    out.push_back((char)(value & 0xFF));
+    out.push_back((char)(value >> 8));
+}
+
+static void append_u32(std::string &out, uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        out.push_back((char)((value >> shift) & 0xFF));
+    }
+}
+
+static void append_u64(std::string &out, uint64_t value) {
+    append_u32(out, (uint32_t)value);
+    append_u32(out, (uint32_t)(value >> 32));
+}
+
+static void append_header(std::string &out, const grid_t &grid, uint16_t flags, uint64_t tick) {
+    out.append(BINARY_FRAME_MAGIC, sizeof(BINARY_FRAME_MAGIC));
+    append_u16(out, BINARY_FRAME_VERSION);
+    append_u16(out, flags);
+    append_u32(out, grid.rows);
+    append_u32(out, grid.columns);
+    append_u64(out, tick);
+}
+
+void write_grid_binary(std::string &out, const grid_t &grid, uint64_t tick) {
+    out.reserve(out.size() + BINARY_FRAME_HEADER_SIZE + grid.size() * sizeof(packed_cell_t));
+    append_header(out, grid, 0, tick);
+    for (uint32_t i = 0; i < grid.rows; i++) {
+        for (uint32_t j = 0; j < grid.columns; j++) {
+            append_u32(out, packed_cell_t::pack(grid.get(i, j)).bits);
+        }
+    }
+}
+
+// Após o cabeçalho: iteração base (u64) e número de mudanças (u32), e então posição e célula (u32 cada) por mudança
+static const size_t BINARY_DELTA_PREFIX_SIZE = 12;
+static const size_t BINARY_DELTA_CHANGE_SIZE = 8;
+
+bool binary_delta_smaller(const grid_t &grid, size_t num_changes) {
+    return BINARY_DELTA_PREFIX_SIZE + num_changes * BINARY_DELTA_CHANGE_SIZE < grid.size() * sizeof(packed_cell_t);
+}
+
+void write_delta_binary(std::string &out, const grid_t &grid, const std::vector<uint32_t> &changes, uint64_t base, uint64_t tick) {
+    out.reserve(out.size() + BINARY_FRAME_HEADER_SIZE + BINARY_DELTA_PREFIX_SIZE + changes.size() * BINARY_DELTA_CHANGE_SIZE);
+    append_header(out, grid, BINARY_FRAME_DELTA, tick);
+    append_u64(out, base);
+    append_u32(out, (uint32_t)changes.size());
+    for (uint32_t index : changes) {
+        append_u32(out, index);
+        append_u32(out, packed_cell_t::pack(grid.get(index / grid.columns, index % grid.columns)).bits);
+    }
+}
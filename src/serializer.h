@@ -0,0 +1,70 @@
+/*
+    Serialização do grid para o formato enviado aos clientes.
+
+    O formato JSON é uma matriz de linhas, e cada célula um objeto
+    {"age":..,"energy":..,"type":".."} (chaves em ordem alfabética, como o
+    nlohmann::json as emite). O conversor para nlohmann::json é mantido para
+    comparação; as rotas usam o serializador direto, que escreve o mesmo texto
+    sem montar a árvore de objetos intermediária.
+
+    O formato binário (application/octet-stream) tem um cabeçalho de 24 bytes
+    seguido de uma célula de 4 bytes por posição, linha a linha, tudo em
+    little-endian:
+        0  magic "ECOS"       4  versão (u16)     6  flags (u16)
+        8  linhas (u32)      12  colunas (u32)   16  iteração (u64)
+    Cada célula usa a codificação de packed_cell_t: tipo nos bits 0-1, idade
+    nos bits 2-8 e energia com sinal nos bits 9-31.
+
+    Respostas delta listam só as células que mudaram desde uma iteração base
+    conhecida pelo cliente. Em JSON:
+        {"base":..,"changes":[{"age":..,"energy":..,"i":..,"j":..,"type":".."},..],"tick":..}
+    Em binário, o quadro tem o bit BINARY_FRAME_DELTA nas flags e, após o
+    cabeçalho, a iteração base (u64), o número de mudanças (u32) e, para cada
+    mudança, a posição da célula no grid (u32, i * colunas + j) e a célula (u32).
+    Quando esse quadro seria maior que o completo (mudanças em mais de metade
+    das células), o servidor envia o completo no lugar.
+*/
+
+#pragma once
+
+#include "grid.h"
+#include "json.hpp"
+#include <string>
+#include <vector>
+
+// Código auxilar para converter o entity_type_t enum em uma string
+NLOHMANN_JSON_SERIALIZE_ENUM(entity_type_t, {
+                                                {empty, " "},
+                                                {plant, "P"},
+                                                {herbivore, "H"},
+                                                {carnivore, "C"},
+                                            })
+
+// Código auxiliar para converter o entity_t struct e o grid em objetos JSON
+namespace nlohmann {
+    void to_json(nlohmann::json &j, const entity_t &e);
+    void to_json(nlohmann::json &j, const grid_t &grid);
+}
+
+// Acrescenta ao fim de out o JSON do grid, idêntico a nlohmann::json(grid).dump()
+void write_grid_json(std::string &out, const grid_t &grid);
+
+static const char BINARY_FRAME_MAGIC[4] = {'E', 'C', 'O', 'S'};
+static const uint16_t BINARY_FRAME_VERSION = 1;
+static const size_t BINARY_FRAME_HEADER_SIZE = 24;
+// Bit das flags que indica um quadro delta
+static const uint16_t BINARY_FRAME_DELTA = 1;
+
+// Acrescenta ao fim de out o quadro binário completo do grid na iteração tick
+void write_grid_binary(std::string &out, const grid_t &grid, uint64_t tick);
+
+// Acrescenta ao fim de out o delta JSON com as células changes (índices no grid)
+// entre as iterações base e tick
+void write_delta_json(std::string &out, const grid_t &grid, const std::vector<uint32_t> &changes, uint64_t base, uint64_t tick);
+
+// Indica se o quadro binário delta com num_changes mudanças é menor que o quadro completo
+// do grid: cada mudança ocupa 8 bytes, contra 4 por célula no quadro completo
+bool binary_delta_smaller(const grid_t &grid, size_t num_changes);
+
+// Acrescenta ao fim de out o quadro binário delta com as células changes entre as iterações base e tick
+void write_delta_binary(std::string &out, const grid_t &grid, const std::vector<uint32_t> &changes, uint64_t base, uint64_t tick);
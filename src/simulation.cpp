@@ -0,0 +1,428 @@
+#include "simulation.h"
+#include "aging.h"
+#include "metrics.h"
+#include "rng.h"
+#include "trace.h"
+
+// Matriz que contém as posições disponíveis (uma por thread, pois as entidades podem ser atualizadas em paralelo)
+thread_local std::vector<std::pair<uint32_t, uint32_t>> available_pos;
+
+// Eventos das entidades ainda não somados às métricas. Cada thread conta nos seus próprios
+// contadores, sem atomics, e os soma em simulation_metrics ao fim de cada tarefa (ver flush_events)
+struct entity_events_t {
+    uint64_t births[4];
+    uint64_t moves[4];
+    uint64_t eats[4];
+};
+thread_local entity_events_t pending_events = {};
+// Atualizações de entidade feitas pela thread, para a amostragem das durações
+thread_local uint32_t entity_updates = 0;
+
+// Soma os eventos da thread às métricas (se ligadas) e zera os contadores
+void flush_events() {
+    if (metrics_enabled.load(std::memory_order_relaxed)) {
+        for (int type = plant; type <= carnivore; type++) {
+            if (pending_events.births[type] != 0) {
+                simulation_metrics.births[type].fetch_add(pending_events.births[type], std::memory_order_relaxed);
+            }
+            if (pending_events.moves[type] != 0) {
+                simulation_metrics.moves[type].fetch_add(pending_events.moves[type], std::memory_order_relaxed);
+            }
+            if (pending_events.eats[type] != 0) {
+                simulation_metrics.eats[type].fetch_add(pending_events.eats[type], std::memory_order_relaxed);
+            }
+        }
+    }
+    pending_events = {};
+}
+
+lock_stats_t entity_lock_totals("entity_mtx", "entity_mtx wait");
+
+// Número de classes de cor do modo checkerboard. A cor (i + 2j) mod 5 garante que
+// duas células da mesma cor estejam a uma distância de Manhattan de pelo menos 3,
+// então as vizinhanças (leitura e escrita a distância 1) nunca se sobrepõem.
+static const uint32_t NUM_COLORS = 5;
+
+// Iteração reservada para os sorteios da colocação inicial das entidades
+static const uint64_t SETUP_TICK = UINT64_MAX;
+
+// Sequência de sorteios da entidade na posição (i, j) na iteração atual
+cell_rng_t entity_rng(const simulation_t &sim, uint32_t i, uint32_t j) {
+    return cell_rng_t(sim.seed, sim.tick, sim.grid.index(i, j));
+}
+
+// Função para gerar um valor randômico com base na probabilidade
+bool random_action(cell_rng_t &rng, float probability) {
+    return rng.next_double() < probability;
+}
+
+// Marca uma posição como analisada, para que não seja atualizada de novo nesta iteração
+void mark_analyzed(simulation_t &sim, uint32_t line, uint32_t column) {
+    sim.analyzed_cells.insert(sim.grid.index(line, column));
+}
+
+// Verifica se a posição já foi analisada nesta iteração
+bool was_analyzed(const simulation_t &sim, uint32_t i, uint32_t j) {
+    return sim.analyzed_cells.contains(sim.grid.index(i, j));
+}
+
+// Thread da planta
+void plant_thread(simulation_t &sim, uint32_t i, uint32_t j) {
+    cell_rng_t rng = entity_rng(sim, i, j);
+    // Lógica de reprodução da planta
+    if (random_action(rng, sim.rules.plant_reproduction_probability)) {
+        // Verifica as casas adjacentes e armazena no vetor available_pos
+        if ((i + 1) < sim.grid.rows && sim.grid.type(i + 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i + 1, j));
+        }
+        if (i > 0 && sim.grid.type(i - 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i - 1, j));
+        }
+        if ((j + 1) < sim.grid.columns && sim.grid.type(i, j + 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j + 1));
+        }
+        if (j > 0 && sim.grid.type(i, j - 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j - 1));
+        }
+        if (!available_pos.empty()) {
+            uint32_t drawing = rng.next_below(available_pos.size());
+            uint32_t line = available_pos[drawing].first;
+            uint32_t column = available_pos[drawing].second;
+            sim.grid.set(line, column, {plant, 0, 0});
+            pending_events.births[plant]++;
+            mark_analyzed(sim, line, column);
+            available_pos.clear();
+        }
+    }
+}
+// Thread do herbívoro
+void herbivore_thread(simulation_t &sim, uint32_t i, uint32_t j) {
+    // A idade e a morte já foram tratadas pelo passo de envelhecimento
+    entity_t entity = sim.grid.get(i, j);
+    cell_rng_t rng = entity_rng(sim, i, j);
+    // Lógica de alimentação do herbívoro
+    if ((i + 1) < sim.grid.rows && sim.grid.type(i + 1, j) == plant && random_action(rng, sim.rules.herbivore_eat_probability)) {
+        sim.grid.set(i + 1, j, {empty, 0, 0});
+        entity.energy += sim.rules.herbivore_eat_energy;
+        pending_events.eats[herbivore]++;
+    }
+    if (i > 0 && sim.grid.type(i - 1, j) == plant && random_action(rng, sim.rules.herbivore_eat_probability)) {
+        sim.grid.set(i - 1, j, {empty, 0, 0});
+        entity.energy += sim.rules.herbivore_eat_energy;
+        pending_events.eats[herbivore]++;
+    }
+    if ((j + 1) < sim.grid.columns && sim.grid.type(i, j + 1) == plant && random_action(rng, sim.rules.herbivore_eat_probability)) {
+        sim.grid.set(i, j + 1, {empty, 0, 0});
+        entity.energy += sim.rules.herbivore_eat_energy;
+        pending_events.eats[herbivore]++;
+    }
+    if (j > 0 && sim.grid.type(i, j - 1) == plant && random_action(rng, sim.rules.herbivore_eat_probability)) {
+        sim.grid.set(i, j - 1, {empty, 0, 0});
+        entity.energy += sim.rules.herbivore_eat_energy;
+        pending_events.eats[herbivore]++;
+    }
+    // Lógica de reprodução do herbívoro
+    if (random_action(rng, sim.rules.herbivore_reproduction_probability) && entity.energy >= sim.rules.reproduction_threshold_energy) {
+        // Verifica as casas adjacentes e armazena no vetor available_pos
+        if ((i + 1) < sim.grid.rows && sim.grid.type(i + 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i + 1, j));
+        }
+        if (i > 0 && sim.grid.type(i - 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i - 1, j));
+        }
+        if ((j + 1) < sim.grid.columns && sim.grid.type(i, j + 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j + 1));
+        }
+        if (j > 0 && sim.grid.type(i, j - 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j - 1));
+        }
+        if (!available_pos.empty()) {
+            uint32_t drawing = rng.next_below(available_pos.size());
+            uint32_t line = available_pos[drawing].first;
+            uint32_t column = available_pos[drawing].second;
+            sim.grid.set(line, column, {herbivore, sim.rules.initial_energy, 0});
+            pending_events.births[herbivore]++;
+            entity.energy = entity.energy - sim.rules.reproduction_energy_cost;
+            mark_analyzed(sim, line, column);
+            available_pos.clear();
+        }
+    }
+    // Lógica de movimentação do herbívoro
+    if (random_action(rng, sim.rules.herbivore_move_probability)) {
+        // Verifica as casas adjacentes e armazena no vetor available_pos
+        if ((i + 1) < sim.grid.rows && sim.grid.type(i + 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i + 1, j));
+        }
+        if (i > 0 && sim.grid.type(i - 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i - 1, j));
+        }
+        if ((j + 1) < sim.grid.columns && sim.grid.type(i, j + 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j + 1));
+        }
+        if (j > 0 && sim.grid.type(i, j - 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j - 1));
+        }
+        if (!available_pos.empty()) {
+            uint32_t drawing = rng.next_below(available_pos.size());
+            uint32_t line = available_pos[drawing].first;
+            uint32_t column = available_pos[drawing].second;
+            sim.grid.set(line, column, {herbivore, entity.energy - sim.rules.move_energy_cost, entity.age});
+            pending_events.moves[herbivore]++;
+            sim.grid.set(i, j, {empty, 0, 0});
+            mark_analyzed(sim, line, column);
+            available_pos.clear();
+            return;
+        }
+    }
+    sim.grid.set(i, j, entity);
+}
+// Thread do carnívoro
+void carnivore_thread(simulation_t &sim, uint32_t i, uint32_t j) {
+    // A idade e a morte já foram tratadas pelo passo de envelhecimento
+    entity_t entity = sim.grid.get(i, j);
+    cell_rng_t rng = entity_rng(sim, i, j);
+    // Lógica de alimentação do carnívoro
+    if (i + 1 < sim.grid.rows && sim.grid.type(i + 1, j) == herbivore && random_action(rng, sim.rules.carnivore_eat_probability)) {
+        sim.grid.set(i + 1, j, {empty, 0, 0});
+        entity.energy += sim.rules.carnivore_eat_energy;
+        pending_events.eats[carnivore]++;
+    }
+    if (i > 0 && sim.grid.type(i - 1, j) == herbivore && random_action(rng, sim.rules.carnivore_eat_probability)) {
+        sim.grid.set(i - 1, j, {empty, 0, 0});
+        entity.energy += sim.rules.carnivore_eat_energy;
+        pending_events.eats[carnivore]++;
+    }
+    if (j + 1 < sim.grid.columns && sim.grid.type(i, j + 1) == herbivore && random_action(rng, sim.rules.carnivore_eat_probability)) {
+        sim.grid.set(i, j + 1, {empty, 0, 0});
+        entity.energy += sim.rules.carnivore_eat_energy;
+        pending_events.eats[carnivore]++;
+    }
+    if (j > 0 && sim.grid.type(i, j - 1) == herbivore && random_action(rng, sim.rules.carnivore_eat_probability)) {
+        sim.grid.set(i, j - 1, {empty, 0, 0});
+        entity.energy += sim.rules.carnivore_eat_energy;
+        pending_events.eats[carnivore]++;
+    }
+    // Lógica de reprodução do carnívoro
+    if (random_action(rng, sim.rules.carnivore_reproduction_probability) && entity.energy >= sim.rules.reproduction_threshold_energy) {
+        // Verifica as casas adjacentes e armazena no vetor available_pos
+        if ((i + 1) < sim.grid.rows && sim.grid.type(i + 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i + 1, j));
+        }
+        if (i > 0 && sim.grid.type(i - 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i - 1, j));
+        }
+        if ((j + 1) < sim.grid.columns && sim.grid.type(i, j + 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j + 1));
+        }
+        if (j > 0 && sim.grid.type(i, j - 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j - 1));
+        }
+        if (!available_pos.empty()) {
+            uint32_t drawing = rng.next_below(available_pos.size());
+            uint32_t line = available_pos[drawing].first;
+            uint32_t column = available_pos[drawing].second;
+            sim.grid.set(line, column, {carnivore, sim.rules.initial_energy, 0});
+            pending_events.births[carnivore]++;
+            entity.energy = entity.energy - sim.rules.reproduction_energy_cost;
+            mark_analyzed(sim, line, column);
+            available_pos.clear();
+        }
+    }
+    // Lógica de movimentação do carnívoro
+    if (random_action(rng, sim.rules.carnivore_move_probability)) {
+        // Verifica as casas adjacentes e armazena no vetor available_pos
+        if ((i + 1) < sim.grid.rows && sim.grid.type(i + 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i + 1, j));
+        }
+        if (i > 0 && sim.grid.type(i - 1, j) == empty) {
+            available_pos.push_back(std::make_pair(i - 1, j));
+        }
+        if ((j + 1) < sim.grid.columns && sim.grid.type(i, j + 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j + 1));
+        }
+        if (j > 0 && sim.grid.type(i, j - 1) == empty) {
+            available_pos.push_back(std::make_pair(i, j - 1));
+        }
+        if (!available_pos.empty()) {
+            uint32_t drawing = rng.next_below(available_pos.size());
+            uint32_t line = available_pos[drawing].first;
+            uint32_t column = available_pos[drawing].second;
+            sim.grid.set(line, column, {carnivore, entity.energy - sim.rules.move_energy_cost, entity.age});
+            pending_events.moves[carnivore]++;
+            sim.grid.set(i, j, {empty, 0, 0});
+            mark_analyzed(sim, line, column);
+            available_pos.clear();
+            return;
+        }
+    }
+    sim.grid.set(i, j, entity);
+}
+
+// Atualiza a entidade na posição (i, j) de acordo com o seu tipo
+void update_entity(simulation_t &sim, uint32_t i, uint32_t j) {
+    entity_type_t type = sim.grid.type(i, j);
+    // Com as métricas ligadas, uma atualização a cada ENTITY_SAMPLE_INTERVAL é cronometrada
+    bool sampled = ++entity_updates % ENTITY_SAMPLE_INTERVAL == 0 && metrics_enabled.load(std::memory_order_relaxed);
+    std::chrono::steady_clock::time_point start;
+    if (sampled) {
+        start = std::chrono::steady_clock::now();
+    }
+    if (type == plant) {
+        plant_thread(sim, i, j);
+    } else if (type == herbivore) {
+        herbivore_thread(sim, i, j);
+    } else if (type == carnivore) {
+        carnivore_thread(sim, i, j);
+    }
+    if (sampled) {
+        simulation_metrics.entity_seconds[type].observe(std::chrono::steady_clock::now() - start);
+    }
+}
+
+// Iteração sequencial: cada entidade é despachada ao pool e aguardada antes da próxima
+// Sem pool (pool nulo), as entidades são atualizadas na própria thread chamadora
+void sequential_iteration(simulation_t &sim, thread_pool_t *pool) {
+    for (uint32_t i = 0; i < sim.grid.rows; i++) {
+        for (uint32_t j = 0; j < sim.grid.columns; j++) {
+            // Caso a posição no grid não tenha sido analisada
+            if (sim.grid.type(i, j) != empty && !was_analyzed(sim, i, j)) {
+                if (pool == nullptr) {
+                    update_entity(sim, i, j);
+                    continue;
+                }
+                std::future<void> done = pool->submit([&sim, i, j]() {
+                    std::lock_guard<instrumented_mutex_t<>> lock(sim.entity_mtx);
+                    update_entity(sim, i, j);
+                    flush_events();
+                });
+                pool->wait(done);
+            }
+        }
+    }
+}
+
+// Iteração paralela: as classes de cor são processadas uma após a outra, e as
+// entidades de uma mesma classe são atualizadas concorrentemente, sem lock global
+void checkerboard_iteration(simulation_t &sim, thread_pool_t *pool) {
+    std::vector<pos_t> &color_cells = sim.color_cells;
+    for (uint32_t color = 0; color < NUM_COLORS; color++) {
+        // Seleciona as entidades desta cor que ainda não foram analisadas
+        {
+            trace_scope_t scope("select", "simulation", "color", color);
+            color_cells.clear();
+            for (uint32_t i = 0; i < sim.grid.rows; i++) {
+                for (uint32_t j = 0; j < sim.grid.columns; j++) {
+                    if ((i + 2 * j) % NUM_COLORS == color && sim.grid.type(i, j) != empty && !was_analyzed(sim, i, j)) {
+                        color_cells.push_back({i, j});
+                    }
+                }
+            }
+        }
+        auto update_range = [&sim, &color_cells](size_t begin, size_t end) {
+            trace_scope_t scope("chunk", "simulation", "entities", end - begin);
+            for (size_t k = begin; k < end; k++) {
+                update_entity(sim, color_cells[k].i, color_cells[k].j);
+            }
+            flush_events();
+        };
+        if (pool == nullptr) {
+            update_range(0, color_cells.size());
+        } else {
+            pool->parallel_for(color_cells.size(), update_range);
+        }
+    }
+}
+
+static void advance(simulation_t &sim, thread_pool_t *pool) {
+    // As fases são cronometradas uma vez só, para as métricas e para o rastreamento
+    bool measured = metrics_enabled.load(std::memory_order_relaxed);
+    bool traced = tracing_enabled.load(std::memory_order_relaxed);
+    bool timed = measured || traced;
+    std::chrono::steady_clock::time_point start, aged, updated, end;
+    if (timed) {
+        start = std::chrono::steady_clock::now();
+    }
+    sim.tick++;
+    // Envelhece todas as entidades e remove as mortas antes do comportamento
+    size_t deaths = age_entities(sim.grid, sim.aging_rules);
+    if (timed) {
+        aged = std::chrono::steady_clock::now();
+    }
+    if (sim.mode == checkerboard) {
+        checkerboard_iteration(sim, pool);
+    } else {
+        sequential_iteration(sim, pool);
+    }
+    sim.analyzed_cells.clear();
+    // Eventos das entidades atualizadas nesta thread (todas, sem pool)
+    flush_events();
+    if (timed) {
+        updated = std::chrono::steady_clock::now();
+    }
+    if (sim.record_history) {
+        sim.history.record(sim.tick, sim.grid);
+    }
+    sim.last_tick_entity_lock = sim.entity_lock_stats.take();
+    entity_lock_totals.add(sim.last_tick_entity_lock);
+    if (timed) {
+        end = std::chrono::steady_clock::now();
+    }
+    if (measured) {
+        simulation_metrics.aging_deaths.fetch_add(deaths, std::memory_order_relaxed);
+        simulation_metrics.aging_seconds.observe(aged - start);
+        simulation_metrics.update_seconds.observe(updated - aged);
+        simulation_metrics.history_seconds.observe(end - updated);
+        simulation_metrics.tick_seconds.observe(end - start);
+    }
+    if (traced) {
+        trace_event("aging", "simulation", start, aged, "deaths", deaths);
+        trace_event("update", "simulation", aged, updated);
+        trace_event("history", "simulation", updated, end);
+        trace_event("tick", "simulation", start, end, "tick", sim.tick);
+    }
+}
+
+void advance_simulation(simulation_t &sim, thread_pool_t &pool) {
+    advance(sim, &pool);
+}
+
+void advance_simulation(simulation_t &sim) {
+    advance(sim, nullptr);
+}
+
+void setup_simulation(simulation_t &sim, uint32_t num_rows, uint32_t num_columns, uint32_t plants, uint32_t herbivores, uint32_t carnivores,
+                      uint64_t seed, update_mode_t mode, const rules_t &rules) {
+    sim.rules = rules;
+    sim.aging_rules = make_aging_rules(rules);
+    sim.grid.assign(num_rows, num_columns, {empty, 0, 0});
+    sim.analyzed_cells.resize(sim.grid.size());
+    sim.history.reset(sim.grid.size());
+    sim.mode = mode;
+    sim.seed = seed;
+    sim.tick = 0;
+    cell_rng_t setup_rng(seed, SETUP_TICK, 0);
+    // Função para criar uma entidade em uma posição aleatória
+    auto create_entity = [&](entity_type_t type, int energy) {
+        uint32_t line, column;
+        do {
+            line = setup_rng.next_below(num_rows);
+            column = setup_rng.next_below(num_columns);
+        } while (sim.grid.type(line, column) != empty);
+        sim.grid.set(line, column, {type, energy, 0});
+    };
+    // Criação das plantas
+    for (uint32_t i = 0; i < plants; i++) {
+        create_entity(plant, 0);
+    }
+    // Criação dos herbívoros
+    for (uint32_t i = 0; i < herbivores; i++) {
+        create_entity(herbivore, rules.initial_energy);
+    }
+    // Criação dos carnívoros
+    for (uint32_t i = 0; i < carnivores; i++) {
+        create_entity(carnivore, rules.initial_energy);
+    }
+    if (sim.record_history) {
+        sim.history.record(sim.tick, sim.grid);
+    }
+}
@@ -0,0 +1,80 @@
+/*
+    Núcleo da simulação: estado de uma simulação, regras das entidades e avanço
+    das iterações. Não depende do servidor HTTP, e é compartilhado pelo ecosim
+    (servidor) e pelo ecosim-batch (execução em lote pela linha de comando).
+*/
+
+#pragma once
+
+#include "change_history.h"
+#include "grid.h"
+#include "instrumented_mutex.h"
+#include "rules.h"
+#include "thread_pool.h"
+#include "visited_set.h"
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Modo de atualização do grid a cada iteração
+enum update_mode_t {
+    // Percorre o grid em ordem, uma entidade por vez, sob o entity_mtx da simulação
+    sequential,
+    // Atualiza em paralelo, sem lock global, cada classe de cor do grid
+    checkerboard
+};
+
+struct pos_t {
+    uint32_t i;
+    uint32_t j;
+};
+
+// Estado de uma simulação
+struct simulation_t {
+    // Grid (matriz) que contém as enidades
+    grid_t grid;
+    // Conjunto das posições que já foram analizadas na iteração atual
+    visited_set_t analyzed_cells;
+    // Células ocupadas nas últimas iterações, para as respostas delta
+    change_history_t history;
+    // Desligado na execução em lote, que não envia deltas
+    bool record_history = true;
+    // Modo de atualização escolhido no início da simulação
+    update_mode_t mode = sequential;
+    // Regras escolhidas no início da simulação, e as do envelhecimento derivadas delas
+    rules_t rules;
+    aging_rules_t aging_rules = {};
+    // Semente da simulação e número da iteração atual: junto com a célula, definem
+    // todos os sorteios feitos por uma entidade (ver rng.h)
+    uint64_t seed = 0;
+    uint64_t tick = 0;
+    // Contadores do entity_mtx na iteração em andamento
+    lock_stats_t entity_lock_stats{"entity_mtx", "entity_mtx wait", ENTITY_SAMPLE_INTERVAL};
+    // Serializa as entidades no modo sequencial
+    instrumented_mutex_t<> entity_mtx{entity_lock_stats};
+    // Contadores do entity_mtx na última iteração completa
+    lock_counts_t last_tick_entity_lock;
+    // Entidades de uma classe de cor no modo checkerboard, reaproveitado entre iterações
+    std::vector<pos_t> color_cells;
+};
+
+// Contadores dos entity_mtx de todas as simulações, somados ao fim de cada iteração
+extern lock_stats_t entity_lock_totals;
+
+// Prepara um grid novo com as entidades iniciais em posições sorteadas. A colocação
+// usa uma iteração reservada da sequência de sorteios da semente.
+void setup_simulation(simulation_t &sim, uint32_t num_rows, uint32_t num_columns, uint32_t plants, uint32_t herbivores, uint32_t carnivores,
+                      uint64_t seed, update_mode_t mode, const rules_t &rules);
+
+// Comportamento de cada tipo de entidade na posição (i, j), na iteração atual. A
+// iteração os chama pela ordem do modo de atualização; expostos para os benchmarks.
+void plant_thread(simulation_t &sim, uint32_t i, uint32_t j);
+void herbivore_thread(simulation_t &sim, uint32_t i, uint32_t j);
+void carnivore_thread(simulation_t &sim, uint32_t i, uint32_t j);
+
+// Avança a simulação uma iteração; as entidades são atualizadas no pool
+void advance_simulation(simulation_t &sim, thread_pool_t &pool);
+
+// Avança a simulação uma iteração inteiramente na thread chamadora, com o mesmo
+// resultado; usado quando o paralelismo está entre simulações independentes
+void advance_simulation(simulation_t &sim);
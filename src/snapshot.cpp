@@ -0,0 +1,222 @@
+#include "snapshot.h"
+#include "checkpoint.h"
+#include "rules.h"
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <type_traits>
+#include <unistd.h>
+
+static const char *const LAYOUT_NAMES[] = {"aos", "packed", "soa"};
+
+// Identificação da representação do grid no cabeçalho
+static const uint32_t GRID_LAYOUT_ID = std::is_same<grid_t, packed_grid_t>::value ? 1 : std::is_same<grid_t, soa_grid_t>::value ? 2 : 0;
+
+// Confere as células com as mesmas regras do checkpoint e devolve a posição da primeira
+// inválida: o tipo indexa tabelas na simulação, então um valor fora delas levaria a leituras
+// fora dos limites
+static bool valid_cells(const grid_t &grid, const aging_rules_t &aging_rules, uint32_t &row, uint32_t &column) {
+    for (row = 0; row < grid.rows; row++) {
+        for (column = 0; column < grid.columns; column++) {
+            entity_t cell = grid.get(row, column);
+            if (!valid_cell((uint32_t)cell.type, cell.age, cell.energy, aging_rules)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint64_t align_up(uint64_t offset) {
+    return (offset + SNAPSHOT_ALIGNMENT - 1) / SNAPSHOT_ALIGNMENT * SNAPSHOT_ALIGNMENT;
+}
+
+static uint64_t header_checksum(const snapshot_header_t &header) {
+    return checkpoint_checksum(reinterpret_cast<const unsigned char *>(&header), offsetof(snapshot_header_t, header_checksum));
+}
+
+// Escreve count bytes zero, o espaço até o próximo plano alinhado
+static bool write_padding(FILE *file, uint64_t count) {
+    static const char zeros[SNAPSHOT_ALIGNMENT] = {};
+    while (count > 0) {
+        size_t chunk = count < sizeof(zeros) ? count : sizeof(zeros);
+        if (std::fwrite(zeros, 1, chunk, file) != chunk) {
+            return false;
+        }
+        count -= chunk;
+    }
+    return true;
+}
+
+bool save_snapshot(const std::string &path, const simulation_t &sim, std::string &error) {
+    if (NUM_RULE_FIELDS > SNAPSHOT_MAXIMUM_RULES) {
+        error = path + ": too many rules for the snapshot format";
+        return false;
+    }
+    snapshot_header_t header = {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.layout = GRID_LAYOUT_ID;
+    header.mode = (uint32_t)sim.mode;
+    header.rows = sim.grid.rows;
+    header.columns = sim.grid.columns;
+    header.tick = sim.tick;
+    header.seed = sim.seed;
+    header.num_rules = (uint32_t)NUM_RULE_FIELDS;
+    for (size_t k = 0; k < NUM_RULE_FIELDS; k++) {
+        header.rules[k] = get_rule(sim.rules, RULE_FIELDS[k]);
+    }
+    uint64_t offset = align_up(sizeof(header));
+    header.cells_checksum = CHECKSUM_OFFSET_BASIS;
+    sim.grid.for_each_plane([&](const auto &plane) {
+        uint64_t bytes = plane.size() * sizeof(plane[0]);
+        header.planes[header.num_planes++] = {offset, bytes};
+        header.cells_checksum = checkpoint_checksum(reinterpret_cast<const unsigned char *>(plane.data()), bytes, header.cells_checksum);
+        offset = align_up(offset + bytes);
+    });
+    header.header_checksum = header_checksum(header);
+
+    std::string temporary = path + ".tmp";
+    FILE *file = std::fopen(temporary.c_str(), "wb");
+    if (file == nullptr) {
+        error = temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1;
+    uint64_t position = sizeof(header);
+    sim.grid.for_each_plane([&](const auto &plane) {
+        uint64_t bytes = plane.size() * sizeof(plane[0]);
+        uint64_t start = align_up(position);
+        written = written && write_padding(file, start - position) && std::fwrite(plane.data(), 1, bytes, file) == bytes;
+        position = start + bytes;
+    });
+    written = std::fclose(file) == 0 && written;
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        error = path + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool load_snapshot(const std::string &path, simulation_t &sim, bool verify, uint32_t maximum_dimension, std::string &error) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) != 0) {
+        error = path + ": " + std::strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    size_t size = status.st_size;
+    if (size < sizeof(snapshot_header_t)) {
+        close(fd);
+        error = path + ": not a snapshot";
+        return false;
+    }
+    // Escrita permitida só na cópia privada das páginas; o arquivo continua só para leitura
+    void *address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    int mmap_errno = errno;
+    close(fd);
+    if (address == MAP_FAILED) {
+        error = path + ": " + std::strerror(mmap_errno);
+        return false;
+    }
+    // Desfaz o mapeamento quando o último plano que o usa deixar de existir
+    std::shared_ptr<void> mapping(address, [size](void *region) { munmap(region, size); });
+    unsigned char *base = static_cast<unsigned char *>(address);
+    const snapshot_header_t &header = *static_cast<const snapshot_header_t *>(address);
+
+    grid_t grid;
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        error = "not a snapshot";
+    } else if (header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        error = "written with another byte order";
+    } else if (header.version != SNAPSHOT_VERSION) {
+        error = "unsupported version " + std::to_string(header.version);
+    } else if (header.header_checksum != header_checksum(header)) {
+        error = "header checksum mismatch";
+    } else if (header.layout != GRID_LAYOUT_ID) {
+        error = std::string("written with the ") + (header.layout < 3 ? LAYOUT_NAMES[header.layout] : "unknown") + " grid layout, built with " +
+                LAYOUT_NAMES[GRID_LAYOUT_ID];
+    } else if (header.mode > checkerboard || header.rows == 0 || header.columns == 0 || header.num_rules != NUM_RULE_FIELDS ||
+               header.num_planes > SNAPSHOT_MAXIMUM_PLANES) {
+        error = "invalid header";
+    } else if (header.rows > maximum_dimension || header.columns > maximum_dimension) {
+        error = "grid larger than " + std::to_string(maximum_dimension) + " cells per side";
+    }
+    if (!error.empty()) {
+        error = path + ": " + error;
+        return false;
+    }
+    rules_t rules;
+    for (size_t k = 0; k < NUM_RULE_FIELDS; k++) {
+        if (!rule_accepts(RULE_FIELDS[k], header.rules[k])) {
+            error = path + ": invalid rule " + RULE_FIELDS[k].name;
+            return false;
+        }
+        set_rule(rules, RULE_FIELDS[k], header.rules[k]);
+    }
+
+    // Cada plano deve estar alinhado, dentro do arquivo e com o tamanho do grid
+    grid.rows = header.rows;
+    grid.columns = header.columns;
+    uint32_t plane_index = 0;
+    uint64_t cells_checksum = CHECKSUM_OFFSET_BASIS;
+    bool planes_valid = true;
+    grid.for_each_plane([&](auto &plane) {
+        using cell_t = typename std::remove_reference<decltype(plane[0])>::type;
+        const snapshot_plane_t &stored = header.planes[plane_index++];
+        if (!planes_valid || plane_index > header.num_planes || stored.bytes != grid.size() * sizeof(cell_t) ||
+            stored.offset % SNAPSHOT_ALIGNMENT != 0 || stored.offset < sizeof(snapshot_header_t) || stored.offset > size || stored.bytes > size - stored.offset) {
+            planes_valid = false;
+            return;
+        }
+        if (verify) {
+            cells_checksum = checkpoint_checksum(base + stored.offset, stored.bytes, cells_checksum);
+        }
+        plane.attach(reinterpret_cast<cell_t *>(base + stored.offset), grid.size(), mapping);
+    });
+    if (!planes_valid || plane_index != header.num_planes) {
+        error = path + ": invalid planes";
+        return false;
+    }
+    if (verify && cells_checksum != header.cells_checksum) {
+        error = path + ": cells checksum mismatch";
+        return false;
+    }
+    aging_rules_t aging_rules = make_aging_rules(rules);
+    uint32_t row, column;
+    if (verify && !valid_cells(grid, aging_rules, row, column)) {
+        error = path + ": invalid cell at " + std::to_string(row) + "," + std::to_string(column);
+        return false;
+    }
+
+    sim.grid = std::move(grid);
+    sim.rules = rules;
+    sim.aging_rules = aging_rules;
+    sim.mode = (update_mode_t)header.mode;
+    sim.tick = header.tick;
+    sim.seed = header.seed;
+    sim.analyzed_cells.resize(sim.grid.size());
+    sim.history.reset(sim.grid.size());
+    sim.last_tick_entity_lock = {};
+    return true;
+}
+
+bool is_snapshot_file(const std::string &path) {
+    char magic[sizeof(SNAPSHOT_MAGIC)];
+    FILE *file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    bool matches = std::fread(magic, 1, sizeof(magic), file) == sizeof(magic) && std::memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) == 0;
+    std::fclose(file);
+    return matches;
+}
@@ -0,0 +1,81 @@
+/*
+    Snapshot de uma simulação para ser mapeado direto na memória (mmap).
+
+    Ao contrário do checkpoint (checkpoint.h), que é portátil e decodificado
+    célula a célula, o snapshot guarda os planos de células exatamente como
+    estão na memória, na representação do grid e na ordem de bytes de quem
+    o gravou. Restaurar é mapear o arquivo com MAP_PRIVATE e validar o
+    cabeçalho: as células não são copiadas, e o sistema só copia
+    uma página quando a simulação a escreve pela primeira vez, então o
+    arquivo nunca é alterado e várias simulações (forks) podem partir do
+    mesmo snapshot, compartilhando as páginas que ainda não mudaram.
+
+    O arquivo começa pelo cabeçalho snapshot_header_t, seguido dos planos
+    (um no aos e no packed; tipos, energias e idades no soa), cada um em um
+    deslocamento múltiplo de SNAPSHOT_ALIGNMENT. O cabeçalho tem o seu
+    próprio checksum. As células só são conferidas com verify, pois isso
+    exige ler o arquivo inteiro e tiraria do fork o seu custo constante: o
+    checksum delas e, como no checkpoint, o tipo, a idade e a energia de
+    cada uma. Sem verify, o arquivo é tratado como confiável (o servidor só
+    lê snapshots do seu próprio diretório, gravados por ele), pois um tipo
+    inválido levaria a leituras fora das tabelas da simulação. Como no
+    checkpoint, o histórico das respostas delta recomeça na iteração
+    restaurada, aqui vazio, para não percorrer o grid.
+*/
+
+#pragma once
+
+#include "simulation.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+static const char SNAPSHOT_MAGIC[8] = {'E', 'C', 'O', 'S', 'S', 'N', 'A', 'P'};
+static const uint32_t SNAPSHOT_VERSION = 1;
+// Gravado na ordem nativa; lido com outro valor, o arquivo veio de uma máquina com a outra ordem de bytes
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+// Alinhamento dos planos: uma página, o que também os alinha para as cargas vetoriais
+static const size_t SNAPSHOT_ALIGNMENT = 4096;
+static const size_t SNAPSHOT_MAXIMUM_PLANES = 3;
+static const size_t SNAPSHOT_MAXIMUM_RULES = 32;
+
+struct snapshot_plane_t {
+    uint64_t offset;
+    uint64_t bytes;
+};
+
+struct snapshot_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    // 0: aos, 1: packed, 2: soa
+    uint32_t layout;
+    uint32_t mode;
+    uint32_t rows;
+    uint32_t columns;
+    uint64_t tick;
+    uint64_t seed;
+    uint32_t num_rules;
+    uint32_t num_planes;
+    snapshot_plane_t planes[SNAPSHOT_MAXIMUM_PLANES];
+    // Parâmetros das regras na ordem de RULE_FIELDS; as posições além de num_rules são zero
+    double rules[SNAPSHOT_MAXIMUM_RULES];
+    // Checksum dos planos, na ordem, e dos bytes do cabeçalho antes deste campo
+    uint64_t cells_checksum;
+    uint64_t header_checksum;
+};
+
+static_assert(sizeof(snapshot_header_t) == 376, "snapshot_header_t must have no padding");
+
+// Grava o snapshot da simulação em path, por meio de um arquivo temporário renomeado no
+// fim: simulações mapeadas de um snapshot anterior no mesmo caminho continuam intactas
+bool save_snapshot(const std::string &path, const simulation_t &sim, std::string &error);
+
+// Restaura a simulação mapeando o snapshot gravado em path. O cabeçalho é sempre conferido;
+// com verify, também o checksum e o conteúdo das células (lendo o arquivo inteiro).
+// Um grid com mais de maximum_dimension linhas ou colunas é recusado antes de qualquer
+// alocação. Em caso de erro, retorna false com o motivo em error, sem alterar a simulação.
+bool load_snapshot(const std::string &path, simulation_t &sim, bool verify, uint32_t maximum_dimension, std::string &error);
+
+// Indica se o arquivo em path começa com o magic de um snapshot
+bool is_snapshot_file(const std::string &path);
@@ -0,0 +1,151 @@
+/*
+    Pool de threads de longa duração usado pela simulação.
+
+    As threads são criadas uma única vez na inicialização do servidor e
+    consomem tarefas de uma fila compartilhada, evitando o custo de criar e
+    destruir uma std::thread para cada entidade a cada iteração.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class thread_pool_t {
+public:
+    explicit thread_pool_t(size_t num_threads) {
+        if (num_threads == 0) {
+            num_threads = 1;
+        }
+        for (size_t k = 0; k < num_threads; k++) {
+            workers.emplace_back([this]() { worker_loop(); });
+        }
+    }
+
+    ~thread_pool_t() {
+        {
+            std::lock_guard<std::mutex> lock(tasks_mtx);
+            stopping = true;
+        }
+        tasks_cv.notify_all();
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+    }
+
+    thread_pool_t(const thread_pool_t &) = delete;
+    thread_pool_t &operator=(const thread_pool_t &) = delete;
+
+    size_t size() const {
+        return workers.size();
+    }
+
+    // Enfileira uma tarefa e retorna um future que fica pronto quando ela termina
+    template <typename F>
+    std::future<void> submit(F &&task) {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+        std::future<void> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(tasks_mtx);
+            tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        tasks_cv.notify_one();
+        return result;
+    }
+
+    // Como submit, mas a tarefa só é executada pelas threads do pool, nunca dentro do wait()
+    // de outra tarefa. Para tarefas que tomam um lock que quem espera pode já ter.
+    template <typename F>
+    std::future<void> submit_to_workers(F &&task) {
+        auto packaged = std::make_shared<std::packaged_task<void()>>(std::forward<F>(task));
+        std::future<void> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(tasks_mtx);
+            worker_tasks.emplace([packaged]() { (*packaged)(); });
+        }
+        tasks_cv.notify_one();
+        return result;
+    }
+
+    // Espera a tarefa de result executando, enquanto isso, tarefas da fila. Assim
+    // uma tarefa do pool pode esperar outras sem travar quando todas as threads
+    // estão ocupadas esperando (ex.: sessões avançadas em paralelo, cada uma
+    // despachando as suas entidades ao pool). As tarefas de submit_to_workers
+    // ficam para as threads do pool.
+    void wait(std::future<void> &result) {
+        while (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            std::function<void()> task;
+            {
+                std::lock_guard<std::mutex> lock(tasks_mtx);
+                if (!tasks.empty()) {
+                    task = std::move(tasks.front());
+                    tasks.pop();
+                }
+            }
+            if (!task) {
+                // Fila vazia: a tarefa esperada já está em execução em outra thread
+                result.wait();
+                break;
+            }
+            task();
+        }
+    }
+
+    // Divide o intervalo [0, count) em blocos e os executa em paralelo.
+    // A thread chamadora também consome blocos e só retorna quando todos terminarem.
+    void parallel_for(size_t count, const std::function<void(size_t, size_t)> &body) {
+        if (count == 0) {
+            return;
+        }
+        size_t chunk = std::max<size_t>(1, count / (workers.size() * 4));
+        size_t num_chunks = (count + chunk - 1) / chunk;
+        auto next_chunk = std::make_shared<std::atomic<size_t>>(0);
+        auto run_chunks = [next_chunk, num_chunks, chunk, count, &body]() {
+            size_t k;
+            while ((k = next_chunk->fetch_add(1)) < num_chunks) {
+                body(k * chunk, std::min(count, (k + 1) * chunk));
+            }
+        };
+        std::vector<std::future<void>> helpers;
+        for (size_t k = 1; k < std::min(workers.size(), num_chunks); k++) {
+            helpers.push_back(submit(run_chunks));
+        }
+        run_chunks();
+        for (std::future<void> &helper : helpers) {
+            wait(helper);
+        }
+    }
+
+private:
+    void worker_loop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(tasks_mtx);
+                tasks_cv.wait(lock, [this]() { return stopping || !tasks.empty() || !worker_tasks.empty(); });
+                if (stopping && tasks.empty() && worker_tasks.empty()) {
+                    return;
+                }
+                std::queue<std::function<void()>> &queue = !tasks.empty() ? tasks : worker_tasks;
+                task = std::move(queue.front());
+                queue.pop();
+            }
+            task();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::queue<std::function<void()>> worker_tasks;
+    std::mutex tasks_mtx;
+    std::condition_variable tasks_cv;
+    bool stopping = false;
+};
@@ -0,0 +1,115 @@
+#include "trace.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> tracing_enabled{false};
+
+// Uma posição do buffer. sequence é 0 enquanto a posição nunca foi escrita, ímpar
+// durante a escrita do evento n (2n + 1) e 2n + 2 quando ele está completo.
+struct trace_slot_t {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<const char *> name{nullptr};
+    std::atomic<const char *> category{nullptr};
+    std::atomic<const char *> arg_name{nullptr};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> duration_ns{0};
+    std::atomic<uint64_t> arg{0};
+};
+
+struct trace_buffer_t {
+    uint32_t tid;
+    // Eventos já escritos pela thread dona
+    std::atomic<uint64_t> written{0};
+    std::unique_ptr<trace_slot_t[]> slots{new trace_slot_t[TRACE_BUFFER_EVENTS]};
+};
+
+// Buffers de todas as threads que já registraram eventos. Eles nunca são liberados,
+// pois a exportação pode ler o buffer de uma thread que já terminou.
+static std::mutex buffers_mtx;
+static std::vector<std::unique_ptr<trace_buffer_t>> buffers;
+static thread_local trace_buffer_t *thread_buffer = nullptr;
+
+// Origem dos tempos dos eventos
+static const std::chrono::steady_clock::time_point trace_epoch = std::chrono::steady_clock::now();
+
+void trace_event(const char *name, const char *category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+                 const char *arg_name, uint64_t arg) {
+    if (thread_buffer == nullptr) {
+        // Primeiro evento da thread: o único ponto com lock
+        std::lock_guard<std::mutex> lock(buffers_mtx);
+        buffers.push_back(std::make_unique<trace_buffer_t>());
+        buffers.back()->tid = buffers.size();
+        thread_buffer = buffers.back().get();
+    }
+    uint64_t n = thread_buffer->written.load(std::memory_order_relaxed);
+    trace_slot_t &slot = thread_buffer->slots[n % TRACE_BUFFER_EVENTS];
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.category.store(category, std::memory_order_relaxed);
+    slot.arg_name.store(arg_name, std::memory_order_relaxed);
+    slot.start_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start - trace_epoch).count(), std::memory_order_relaxed);
+    slot.duration_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+    thread_buffer->written.store(n + 1, std::memory_order_release);
+}
+
+// Acrescenta um tempo em nanossegundos como microssegundos, a unidade do formato
+static void append_microseconds(std::string &out, int64_t nanoseconds) {
+    char text[32];
+    std::snprintf(text, sizeof(text), "%lld.%03lld", (long long)(nanoseconds / 1000), (long long)(nanoseconds % 1000));
+    out += text;
+}
+
+void write_trace_json(std::string &out) {
+    std::vector<trace_buffer_t *> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(buffers_mtx);
+        for (const std::unique_ptr<trace_buffer_t> &buffer : buffers) {
+            snapshot.push_back(buffer.get());
+        }
+    }
+    out += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (trace_buffer_t *buffer : snapshot) {
+        out += first ? "" : ",";
+        first = false;
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(buffer->tid) + ",\"args\":{\"name\":\"thread " +
+               std::to_string(buffer->tid) + "\"}}";
+        uint64_t written = buffer->written.load(std::memory_order_acquire);
+        uint64_t oldest = written > TRACE_BUFFER_EVENTS ? written - TRACE_BUFFER_EVENTS : 0;
+        for (uint64_t n = oldest; n < written; n++) {
+            trace_slot_t &slot = buffer->slots[n % TRACE_BUFFER_EVENTS];
+            // Leitura otimista: o evento só vale se a sequência for a mesma antes e depois
+            uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+            const char *name = slot.name.load(std::memory_order_relaxed);
+            const char *category = slot.category.load(std::memory_order_relaxed);
+            const char *arg_name = slot.arg_name.load(std::memory_order_relaxed);
+            int64_t start_ns = slot.start_ns.load(std::memory_order_relaxed);
+            int64_t duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+            uint64_t arg = slot.arg.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence != 2 * n + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+                continue;
+            }
+            out += ",{\"name\":\"";
+            out += name;
+            out += "\",\"cat\":\"";
+            out += category;
+            out += "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(buffer->tid) + ",\"ts\":";
+            append_microseconds(out, start_ns);
+            out += ",\"dur\":";
+            append_microseconds(out, duration_ns);
+            if (arg_name != nullptr) {
+                out += ",\"args\":{\"";
+                out += arg_name;
+                out += "\":" + std::to_string(arg) + "}";
+            }
+            out += "}";
+        }
+    }
+    out += "]}";
+}
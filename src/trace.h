@@ -0,0 +1,60 @@
+/*
+    Rastreamento das fases das iterações e das requisições, exportado no
+    formato Trace Event do Chrome (chrome://tracing ou ui.perfetto.dev).
+
+    Desligado por padrão (ecosim --trace liga). Cada trace_scope_t registra
+    um evento completo (fase "X": início e duração) ao sair do escopo, no
+    buffer circular da thread que o executa: só a dona escreve no buffer,
+    sem locks nem atomics compartilhados, e os eventos mais antigos são
+    sobrescritos quando ele enche. A leitura (write_trace_json) pode ocorrer
+    durante a escrita; cada posição tem um número de sequência, e as que
+    estavam sendo sobrescritas no momento são descartadas.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Eventos guardados por thread; os mais antigos são descartados
+static const size_t TRACE_BUFFER_EVENTS = 65536;
+
+extern std::atomic<bool> tracing_enabled;
+
+// Registra um evento de start a end na thread atual. name e category devem ser
+// literais (só o ponteiro é guardado); arg_name pode ser nullptr.
+void trace_event(const char *name, const char *category, std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end,
+                 const char *arg_name = nullptr, uint64_t arg = 0);
+
+// Escreve os eventos de todas as threads como um documento JSON {"traceEvents":[..]}
+void write_trace_json(std::string &out);
+
+// Registra um evento do início ao fim do escopo, se o rastreamento estiver ligado
+class trace_scope_t {
+public:
+    trace_scope_t(const char *name, const char *category, const char *arg_name = nullptr, uint64_t arg = 0)
+        : name(name), category(category), arg_name(arg_name), arg(arg), active(tracing_enabled.load(std::memory_order_relaxed)) {
+        if (active) {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~trace_scope_t() {
+        if (active) {
+            trace_event(name, category, start, std::chrono::steady_clock::now(), arg_name, arg);
+        }
+    }
+
+    trace_scope_t(const trace_scope_t &) = delete;
+    trace_scope_t &operator=(const trace_scope_t &) = delete;
+
+private:
+    const char *name;
+    const char *category;
+    const char *arg_name;
+    uint64_t arg;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+};
@@ -0,0 +1,44 @@
+/*
+    Conjunto de células visitadas durante uma iteração.
+
+    Cada célula guarda a geração em que foi marcada pela última vez, então
+    marcar e consultar são O(1) e limpar o conjunto é só avançar a geração.
+    Células diferentes ocupam posições diferentes do vetor, então threads que
+    atualizam vizinhanças disjuntas podem marcar células sem lock.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+class visited_set_t {
+public:
+    // Redimensiona o conjunto para num_cells células, todas não visitadas
+    void resize(size_t num_cells) {
+        stamps.assign(num_cells, 0);
+        generation = 1;
+    }
+
+    bool contains(size_t index) const {
+        return stamps[index] == generation;
+    }
+
+    void insert(size_t index) {
+        stamps[index] = generation;
+    }
+
+    // Esvazia o conjunto; só percorre o vetor quando o contador de gerações dá a volta
+    void clear() {
+        generation++;
+        if (generation == 0) {
+            std::fill(stamps.begin(), stamps.end(), 0);
+            generation = 1;
+        }
+    }
+
+private:
+    std::vector<uint32_t> stamps;
+    uint32_t generation = 1;
+};
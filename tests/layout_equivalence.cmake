@@ -0,0 +1,51 @@
+# Roda o ecosim-batch compilado com o layout aos (AOS_BATCH) e com o packed
+# (PACKED_BATCH) nas mesmas condições e exige a mesma série e o mesmo checkpoint.
+# As regras usam os maiores valores aceitos: se uma energia alcançável não coubesse
+# nos 23 bits do packed, as duas execuções divergiriam.
+#
+#   cmake -DAOS_BATCH=... -DPACKED_BATCH=... -DWORK_DIR=... -P layout_equivalence.cmake
+
+set(common --width 48 --height 32 --plants 600 --herbivores 300 --carnivores 100 --seed 3 --ticks 120
+    --rule plant_maximum_age=127 --rule herbivore_maximum_age=127 --rule carnivore_maximum_age=127
+    --rule initial_energy=8000 --rule herbivore_eat_energy=8000 --rule carnivore_eat_energy=8000)
+
+# Todos os parâmetros no máximo da faixa
+set(maximum_rules
+    --rule plant_reproduction_probability=1 --rule herbivore_reproduction_probability=1
+    --rule carnivore_reproduction_probability=1 --rule herbivore_move_probability=1
+    --rule herbivore_eat_probability=1 --rule carnivore_move_probability=1 --rule carnivore_eat_probability=1
+    --rule reproduction_threshold_energy=8000 --rule reproduction_energy_cost=8000 --rule move_energy_cost=8000)
+
+# O pior caso da energia: comer sempre, nunca gastar
+set(accumulating_rules
+    --rule plant_reproduction_probability=1 --rule herbivore_reproduction_probability=0
+    --rule carnivore_reproduction_probability=0 --rule herbivore_move_probability=0
+    --rule herbivore_eat_probability=1 --rule carnivore_move_probability=0 --rule carnivore_eat_probability=1
+    --rule reproduction_threshold_energy=8000 --rule reproduction_energy_cost=0 --rule move_energy_cost=0)
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+foreach(scenario maximum accumulating)
+    foreach(mode sequential checkerboard)
+        foreach(layout aos packed)
+            if(layout STREQUAL "aos")
+                set(batch ${AOS_BATCH})
+            else()
+                set(batch ${PACKED_BATCH})
+            endif()
+            set(prefix ${WORK_DIR}/${scenario}-${mode}-${layout})
+            execute_process(COMMAND ${batch} ${common} ${${scenario}_rules} --mode ${mode} --checkpoint ${prefix}.ckpt
+                OUTPUT_FILE ${prefix}.csv RESULT_VARIABLE result)
+            if(NOT result EQUAL 0)
+                message(FATAL_ERROR "${batch} failed (${scenario}, ${mode}): ${result}")
+            endif()
+        endforeach()
+        foreach(extension csv ckpt)
+            set(prefix ${WORK_DIR}/${scenario}-${mode})
+            execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${prefix}-aos.${extension} ${prefix}-packed.${extension}
+                RESULT_VARIABLE result)
+            if(NOT result EQUAL 0)
+                message(FATAL_ERROR "aos and packed layouts differ (${scenario}, ${mode}, ${extension})")
+            endif()
+        endforeach()
+    endforeach()
+endforeach()
@@ -0,0 +1,46 @@
+# Roda o ecosim-batch (BATCH) direto até a iteração T e, em outra execução, para em K,
+# grava um checkpoint e um snapshot e retoma de cada um deles até T. As retomadas devem
+# escrever as mesmas linhas que a execução contínua a partir de K e terminar no mesmo
+# estado (mesmo checkpoint final).
+#
+#   cmake -DBATCH=... -DWORK_DIR=... -P restore_equivalence.cmake
+
+set(common --width 48 --height 32 --plants 600 --herbivores 300 --carnivores 100 --seed 3)
+set(interrupted 45)
+set(total 120)
+
+function(run_batch output)
+    execute_process(COMMAND ${BATCH} ${ARGN} OUTPUT_FILE ${output} RESULT_VARIABLE result)
+    if(NOT result EQUAL 0)
+        message(FATAL_ERROR "${BATCH} ${ARGN} failed: ${result}")
+    endif()
+endfunction()
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+foreach(mode sequential checkerboard)
+    set(prefix ${WORK_DIR}/${mode})
+    run_batch(${prefix}-continuous.csv ${common} --mode ${mode} --ticks ${total} --checkpoint ${prefix}-continuous.ckpt)
+    run_batch(${prefix}-interrupted.csv ${common} --mode ${mode} --ticks ${interrupted}
+        --checkpoint ${prefix}-interrupted.ckpt --snapshot ${prefix}-interrupted.snap)
+    # A série contínua a partir de K: o cabeçalho e as linhas das iterações K a T, sem as
+    # das iterações 0 a K - 1 (posições 1 a K, depois do cabeçalho)
+    file(STRINGS ${prefix}-continuous.csv expected)
+    set(before_interruption)
+    foreach(k RANGE 1 ${interrupted})
+        list(APPEND before_interruption ${k})
+    endforeach()
+    list(REMOVE_AT expected ${before_interruption})
+    foreach(source ckpt snap)
+        run_batch(${prefix}-resumed-${source}.csv --restore ${prefix}-interrupted.${source} --ticks ${total}
+            --checkpoint ${prefix}-resumed-${source}.ckpt)
+        file(STRINGS ${prefix}-resumed-${source}.csv resumed)
+        if(NOT resumed STREQUAL expected)
+            message(FATAL_ERROR "run resumed from the ${source} at ${interrupted} differs from the continuous run (${mode})")
+        endif()
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${prefix}-continuous.ckpt ${prefix}-resumed-${source}.ckpt
+            RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "state resumed from the ${source} at ${interrupted} differs at ${total} (${mode})")
+        endif()
+    endforeach()
+endforeach()
@@ -0,0 +1,32 @@
+# Roda o ecosim-batch (BATCH) com uma e com oito threads nas mesmas condições e exige
+# a mesma série e o mesmo checkpoint: os sorteios de cada célula dependem só da
+# semente, da iteração e da posição, nunca da ordem em que as threads as visitam.
+# As réplicas também são comparadas, pois rodam em paralelo entre si.
+#
+#   cmake -DBATCH=... -DWORK_DIR=... -P thread_equivalence.cmake
+
+set(common --width 48 --height 32 --plants 600 --herbivores 300 --carnivores 100 --seed 3 --ticks 120)
+
+file(MAKE_DIRECTORY ${WORK_DIR})
+foreach(mode sequential checkerboard)
+    foreach(threads 1 8)
+        set(prefix ${WORK_DIR}/${mode}-${threads})
+        execute_process(COMMAND ${BATCH} ${common} --mode ${mode} --threads ${threads} --checkpoint ${prefix}.ckpt
+            OUTPUT_FILE ${prefix}.csv RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${BATCH} failed (${mode}, ${threads} threads): ${result}")
+        endif()
+        execute_process(COMMAND ${BATCH} ${common} --mode ${mode} --threads ${threads} --replicas 4
+            OUTPUT_FILE ${prefix}.replicas.csv RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "${BATCH} failed (${mode}, ${threads} threads, replicas): ${result}")
+        endif()
+    endforeach()
+    foreach(file csv ckpt replicas.csv)
+        set(prefix ${WORK_DIR}/${mode})
+        execute_process(COMMAND ${CMAKE_COMMAND} -E compare_files ${prefix}-1.${file} ${prefix}-8.${file} RESULT_VARIABLE result)
+        if(NOT result EQUAL 0)
+            message(FATAL_ERROR "1 and 8 threads differ (${mode}, ${file})")
+        endif()
+    endforeach()
+endforeach()
@@ -0,0 +1,236 @@
+/*
+    Teste de desconexões no /ws durante o relógio das sessões: inicia o
+    servidor em uma porta livre, cria várias sessões com relógio de 10 ms e,
+    por alguns segundos, clientes do /ws se inscrevem, recebem alguns quadros
+    e fecham o socket sem aviso, enquanto outras conexões avançam as mesmas
+    sessões pelo HTTP (os dois caminhos que chamam o broadcast_frames). O
+    servidor deve continuar respondendo e encerrar normalmente com SIGINT.
+
+    Uma conexão usada depois de apagada nem sempre derruba o processo; para
+    a conferência completa, compile com -DCMAKE_CXX_FLAGS=-fsanitize=address
+    e rode com ASAN_OPTIONS=detect_leaks=0 (o Crow não libera tudo ao sair):
+    o AddressSanitizer aborta o servidor, o que faz o teste falhar.
+
+    Uso: ws_disconnect <caminho do ecosim>
+*/
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+static const int NUM_SESSIONS = 8;
+static const int NUM_VIEWER_THREADS = 8;
+static const int NUM_HTTP_THREADS = 2;
+static const std::chrono::seconds DURATION(4);
+
+// Conecta a 127.0.0.1:port, com timeout de leitura para não travar se o servidor parar
+static int connect_to(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    timeval timeout = {5, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return fd;
+}
+
+static bool send_all(int fd, const std::string &data) {
+    for (size_t sent = 0; sent < data.size();) {
+        ssize_t written = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (written <= 0) {
+            return false;
+        }
+        sent += written;
+    }
+    return true;
+}
+
+// Faz uma requisição HTTP em uma conexão nova e retorna o status (0 em caso de erro),
+// com o id da sessão, se houver, em session
+static int http_request(uint16_t port, const std::string &method, const std::string &path, const std::string &body, std::string *session = nullptr) {
+    int fd = connect_to(port);
+    if (fd < 0) {
+        return 0;
+    }
+    std::string message = method + " " + path + " HTTP/1.1\r\nHost: localhost\r\nAccept: application/octet-stream\r\nConnection: close\r\n";
+    message += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    std::string response;
+    if (send_all(fd, message)) {
+        char chunk[65536];
+        ssize_t count;
+        while ((count = recv(fd, chunk, sizeof(chunk), 0)) > 0) {
+            response.append(chunk, count);
+        }
+    }
+    close(fd);
+    if (response.compare(0, 9, "HTTP/1.1 ") != 0) {
+        return 0;
+    }
+    size_t header = response.find("X-Ecosim-Session: ");
+    if (session != nullptr && header != std::string::npos) {
+        *session = response.substr(header + 18, response.find("\r\n", header) - header - 18);
+    }
+    return std::atoi(response.c_str() + 9);
+}
+
+// Quadro de texto do cliente (mascarado, como o protocolo exige)
+static std::string websocket_text(const std::string &text) {
+    std::string frame = {(char)0x81, (char)(0x80 | text.size())};
+    const char mask[4] = {0x12, 0x34, 0x56, 0x78};
+    frame.append(mask, sizeof(mask));
+    for (size_t k = 0; k < text.size(); k++) {
+        frame += (char)(text[k] ^ mask[k % 4]);
+    }
+    return frame;
+}
+
+// Inscreve um cliente do /ws na sessão, lê até bytes_to_read bytes de quadros e fecha o socket sem aviso
+static bool churn_viewer(uint16_t port, const std::string &session, size_t bytes_to_read) {
+    int fd = connect_to(port);
+    if (fd < 0) {
+        return false;
+    }
+    std::string handshake = "GET /ws HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n";
+    bool ok = send_all(fd, handshake);
+    // A inscrição só pode ir depois da resposta do handshake; bytes enviados antes dela se perdem
+    std::string response;
+    char chunk[4096];
+    while (ok && response.find("\r\n\r\n") == std::string::npos) {
+        ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+        ok = count > 0;
+        response.append(chunk, ok ? count : 0);
+    }
+    ok = ok && response.compare(0, 12, "HTTP/1.1 101") == 0 &&
+         send_all(fd, websocket_text("{\"session\":\"" + session + "\",\"interval_ms\":10}"));
+    for (size_t received = response.size() - response.find("\r\n\r\n") - 4; ok && received < bytes_to_read;) {
+        ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+        ok = count > 0;
+        received += ok ? count : 0;
+    }
+    // Sem quadro de fechamento: o servidor descobre a saída pela leitura que falha
+    linger abort = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_LINGER, &abort, sizeof(abort));
+    close(fd);
+    return ok;
+}
+
+// Porta livre escolhida pelo sistema
+static uint16_t free_port() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+    getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+    close(fd);
+    return ntohs(address.sin_port);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <ecosim>\n", argv[0]);
+        return 2;
+    }
+    uint16_t port = free_port();
+    std::string port_text = std::to_string(port);
+    pid_t server = fork();
+    if (server == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        execl(argv[1], argv[1], "--port", port_text.c_str(), "--http-threads", "4", (char *)nullptr);
+        _exit(127);
+    }
+    auto fail = [server](const char *message) {
+        std::fprintf(stderr, "%s\n", message);
+        kill(server, SIGKILL);
+        waitpid(server, nullptr, 0);
+        return 1;
+    };
+
+    std::vector<std::string> sessions(NUM_SESSIONS);
+    std::string body = "{\"width\":64,\"height\":64,\"plants\":800,\"herbivores\":300,\"carnivores\":100,\"seed\":1}";
+    for (int attempt = 0; attempt < 50 && http_request(port, "POST", "/start-simulation", body, &sessions[0]) != 200; attempt++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (sessions[0].empty()) {
+        return fail("server did not start");
+    }
+    for (int k = 1; k < NUM_SESSIONS; k++) {
+        if (http_request(port, "POST", "/start-simulation", body, &sessions[k]) != 200) {
+            return fail("could not create a session");
+        }
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> viewers{0}, requests{0}, failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < NUM_VIEWER_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            // Clientes que saem logo após a inscrição e outros depois de alguns quadros do relógio
+            for (uint64_t k = t; !stop; k++) {
+                bool ok = churn_viewer(port, sessions[k % NUM_SESSIONS], k % 3 == 0 ? 1 : 64 * 1024);
+                (ok ? viewers : failures)++;
+            }
+        });
+    }
+    for (int t = 0; t < NUM_HTTP_THREADS; t++) {
+        threads.emplace_back([&, t]() {
+            for (uint64_t k = t; !stop; k++) {
+                int status = http_request(port, "GET", "/next-iteration?session=" + sessions[k % NUM_SESSIONS], "");
+                (status == 200 ? requests : failures)++;
+            }
+        });
+    }
+    std::this_thread::sleep_for(DURATION);
+    stop = true;
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+    std::printf("%llu viewers, %llu requests, %llu failures\n", (unsigned long long)viewers, (unsigned long long)requests, (unsigned long long)failures);
+
+    if (waitpid(server, nullptr, WNOHANG) != 0) {
+        return fail("server exited during the test");
+    }
+    if (failures != 0 || viewers == 0 || requests == 0) {
+        return fail("requests failed");
+    }
+    if (http_request(port, "GET", "/next-iteration?session=" + sessions[0], "") != 200) {
+        return fail("server stopped answering");
+    }
+    kill(server, SIGINT);
+    int status = 0;
+    pid_t exited = 0;
+    for (int attempt = 0; attempt < 200 && (exited = waitpid(server, &status, WNOHANG)) == 0; attempt++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    if (exited == 0) {
+        return fail("server did not exit after SIGINT");
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        std::fprintf(stderr, "server did not exit cleanly (status %d)\n", status);
+        return 1;
+    }
+    return 0;
+}